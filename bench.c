@@ -0,0 +1,1811 @@
+#include "bench.h"
+#include "chunk.h"
+#include "mesh.h"
+#include "threadpool.h"
+#include "render.h"
+#include "frustum.h"
+#include "visibility.h"
+#include "meshjobs.h"
+#include "chunkmap.h"
+#include "region.h"
+#include "mapfile.h"
+#include "meshcache.h"
+#include "terrain.h"
+#include "structures.h"
+#include "drawbatch.h"
+#include "renderdistance.h"
+#include "raycast.h"
+#include "physics.h"
+#include "character.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#define GEN_BENCH_SIDE 48 //48 x 48 chunks per run
+#define MESH_BENCH_TERRAIN 16 //Terrain chunks meshed per pass
+#define MESH_BENCH_RANDOM 4 //Random fill chunks meshed per pass
+#define MESH_BENCH_PASSES 20
+#define DRAW_BENCH_SIDE 8 //8 x 8 copies of the chunk under test per frame
+#define DRAW_BENCH_FRAMES 200
+#define FRUSTUM_BENCH_CAMERAS 64
+#define FRUSTUM_BENCH_BOXES 2000
+#define RING_BENCH_LEG 10 //Border crossings per side of the square walk
+#define MAP_BENCH_SIDE 64
+#define MAP_BENCH_LOOKUPS 4000000
+#define HEIGHT_BENCH_SIDE 16 //16 x 16 columns, every layer
+#define REGION_BENCH_DIRECTORY "bench_world" //Created and removed again by --region-bench
+#define REGION_BENCH_REWRITES 8 //Rounds of edits saved over the same chunks
+#define MESH_CACHE_BENCH_SIDE 12 //Columns per side of each area visited
+#define EDIT_BENCH_RADIUS 10 //Sphere carved by --edit-bench
+#define TERRAIN_BENCH_SIDE 64 //64 x 64 chunk columns per generator
+#define FEATURE_BENCH_SIDE 24 //24 x 24 columns, every layer
+#define LOD_BENCH_RADIUS 40 //Square of 81 x 81 columns around the centre, reaches the 8x ring
+#define BATCH_BENCH_SIDE 24 //24 x 24 terrain columns, every layer, drawn per chunk and batched
+#define BATCH_BENCH_PATCHES 2000 //Meshes stored again over their own range
+#define DISTANCE_BENCH_FRAMES 12000 //Simulated frames per machine
+#define RAY_BENCH_RADIUS 14 //Columns resident around the spawn, no ray reaches past them
+#define RAY_BENCH_RAYS 20000 //Per ray set
+#define PHYSICS_BENCH_RADIUS 9 //Columns resident around the spawn, no body walks past them
+#define PHYSICS_BENCH_BODIES 512
+#define PHYSICS_BENCH_STEPS 2400 //20 seconds of PHYSICS_STEP
+#define SURFACE_LAYER ((WORLD_HEIGHT / 3) / CHUNK_HEIGHT) //Layer the terrain's base height falls in
+
+//Adversarial chunk contents for the mesher and draw benchmarks
+typedef enum BenchPattern {
+    PATTERN_CHECKERBOARD, //Every solid block fully exposed, nothing merges. Most quads a chunk can produce
+    PATTERN_PILLARS,      //Diagonal 1 x 1 columns, side faces merge vertically only
+    PATTERN_COUNT
+} BenchPattern;
+
+static const char *patternNames[PATTERN_COUNT] = { "checkerboard", "pillars" };
+
+static uint64_t hashBytes(uint64_t hash, const void *data, size_t size)
+{
+    //FNV-1a
+    const uint8_t *bytes = data;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static uint64_t hashChunkBlocks(uint64_t hash, const Chunk *chunk)
+{
+    uint8_t raw[SECTION_VOLUME];
+    for (int s = 0; s < CHUNK_SECTIONS; s++)
+    {
+        unpackSection(&chunk->sections[s], raw);
+        hash = hashBytes(hash, raw, sizeof(raw));
+    }
+    return hash;
+}
+
+static void fillPattern(ChunkSnapshot *snapshot, BenchPattern pattern)
+{
+    //Border stays air so the outer faces are emitted as well
+    memset(snapshot->blocks, AIR, sizeof(snapshot->blocks));
+    for (int x = 0; x < CHUNK_WIDTH; x++)
+        for (int y = 0; y < CHUNK_HEIGHT; y++)
+            for (int z = 0; z < CHUNK_WIDTH; z++)
+            {
+                bool solid = (pattern == PATTERN_CHECKERBOARD) ? ((x + y + z) & 1) == 0 : ((x + z) & 1) == 0;
+                snapshot->blocks[x + 1][y + 1][z + 1] = solid ? SOLID : AIR;
+            }
+}
+
+static void resetChunk(Chunk *chunk)
+{
+    for (int s = 0; s < CHUNK_SECTIONS; s++)
+        freeSection(&chunk->sections[s]);
+    memset(chunk, 0, sizeof(*chunk));
+}
+
+bool runBenchmark(const char *name)
+{
+    if (strcmp(name, "--gen-bench") == 0) runGenBench();
+    else if (strcmp(name, "--mesh-bench") == 0) runMeshBench();
+    else if (strcmp(name, "--draw-bench") == 0) runDrawBench();
+    else if (strcmp(name, "--frustum-bench") == 0) runFrustumBench();
+    else if (strcmp(name, "--cull-bench") == 0) runCullBench();
+    else if (strcmp(name, "--ring-bench") == 0) runRingBench();
+    else if (strcmp(name, "--map-bench") == 0) runMapBench();
+    else if (strcmp(name, "--height-bench") == 0) runHeightBench();
+    else if (strcmp(name, "--region-bench") == 0) runRegionBench();
+    else if (strcmp(name, "--meshcache-bench") == 0) runMeshCacheBench();
+    else if (strcmp(name, "--edit-bench") == 0) runEditBench();
+    else if (strcmp(name, "--terrain-bench") == 0) runTerrainBench();
+    else if (strcmp(name, "--feature-bench") == 0) runFeatureBench();
+    else if (strcmp(name, "--lod-bench") == 0) runLodBench();
+    else if (strcmp(name, "--batch-bench") == 0) runBatchBench();
+    else if (strcmp(name, "--distance-bench") == 0) runDistanceBench();
+    else if (strcmp(name, "--ray-bench") == 0) runRayBench();
+    else if (strcmp(name, "--physics-bench") == 0) runPhysicsBench();
+    else
+    {
+        printf("Unknown option %s\n", name);
+        printf("Benchmarks: --gen-bench --mesh-bench --draw-bench --frustum-bench --cull-bench --ring-bench --map-bench --height-bench --region-bench --meshcache-bench --edit-bench --terrain-bench --feature-bench --lod-bench --batch-bench --distance-bench --ray-bench --physics-bench\n");
+        return false;
+    }
+    return true;
+}
+
+void runGenBench(void)
+{
+    //Chunks outside the world map, only the terrain fill is measured
+    int count = GEN_BENCH_SIDE * GEN_BENCH_SIDE;
+    Chunk *benchChunks = calloc(count, sizeof(Chunk));
+    ChunkGenTask *tasks = malloc(count * sizeof(ChunkGenTask));
+    for (int i = 0; i < count; i++)
+    {
+        int cx = i / GEN_BENCH_SIDE;
+        int cz = i % GEN_BENCH_SIDE;
+        tasks[i] = (ChunkGenTask){ &benchChunks[i], cx, SURFACE_LAYER, cz };
+    }
+
+    int cpus = getCpuCount();
+    printf("Generation benchmark: %d chunks per run, %d cores\n", count, cpus);
+
+    uint64_t reference = 0;
+    double baseRate = 0.0;
+    for (int threads = 1; ; threads = (threads * 2 > cpus && threads < cpus) ? cpus : threads * 2)
+    {
+        //The calling thread works too, so the pool only needs threads - 1 helpers
+        ThreadPool *pool = (threads > 1) ? createThreadPool(threads - 1) : NULL;
+
+        double start = getWallTime();
+        generateChunks(pool, tasks, count);
+        double elapsed = getWallTime() - start;
+        destroyThreadPool(pool);
+
+        uint64_t hash = 1469598103934665603ULL;
+        for (int i = 0; i < count; i++)
+            hash = hashChunkBlocks(hash, tasks[i].chunk);
+        if (threads == 1) reference = hash;
+
+        double rate = count / elapsed;
+        if (threads == 1) baseRate = rate;
+        printf("  %2d threads: %9.0f chunks/s  %5.2fx  %s\n", threads, rate, rate / baseRate,
+            hash == reference ? "identical" : "MISMATCH");
+
+        for (int i = 0; i < count; i++)
+            resetChunk(tasks[i].chunk);
+        if (threads >= cpus) break;
+    }
+
+    free(tasks);
+    free(benchChunks);
+}
+
+static bool sameQuads(const QuadList *a, const QuadList *b)
+{
+    return a->count == b->count && memcmp(a->quads, b->quads, a->count * sizeof(MeshQuad)) == 0;
+}
+
+void runMeshBench(void)
+{
+    initChunks();
+
+    //Terrain chunks away from the world edge plus a few noisy ones that stress merging
+    int count = MESH_BENCH_TERRAIN + MESH_BENCH_RANDOM;
+    ChunkSnapshot *snapshots = malloc(count * sizeof(ChunkSnapshot));
+    for (int n = 0; n < MESH_BENCH_TERRAIN; n++)
+        snapshotChunk(&snapshots[n], 20 + n % 4, SURFACE_LAYER, 20 + n / 4);
+    uint32_t seed = 12345;
+    for (int n = MESH_BENCH_TERRAIN; n < count; n++)
+    {
+        snapshotChunk(&snapshots[n], 30, SURFACE_LAYER, 30);
+        uint8_t *blocks = &snapshots[n].blocks[0][0][0];
+        int density = 20 + 20 * (n - MESH_BENCH_TERRAIN);
+        for (size_t b = 0; b < sizeof(snapshots[n].blocks); b++)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            blocks[b] = ((seed >> 16) % 100) < (uint32_t)density ? SOLID : AIR;
+        }
+    }
+
+    QuadList reference = {0};
+    QuadList binary = {0};
+    bool identical = true;
+    long long quads = 0;
+    double greedyTime = 0.0, binaryTime = 0.0;
+
+    for (int pass = 0; pass < MESH_BENCH_PASSES; pass++)
+    {
+        for (int n = 0; n < count; n++)
+        {
+            reference.count = 0;
+            binary.count = 0;
+
+            double start = getWallTime();
+            for (int face = 0; face < 6; face++)
+                greedyMesh(&reference, &snapshots[n], face);
+            greedyTime += getWallTime() - start;
+
+            start = getWallTime();
+            binaryGreedyMesh(&binary, &snapshots[n]);
+            binaryTime += getWallTime() - start;
+
+            if (pass == 0)
+            {
+                identical = identical && sameQuads(&reference, &binary);
+                quads += reference.count;
+            }
+        }
+    }
+
+    int meshes = count * MESH_BENCH_PASSES;
+    printf("Mesher benchmark: %d chunks (%d terrain, %d random), %lld quads per pass\n", count, MESH_BENCH_TERRAIN, MESH_BENCH_RANDOM, quads);
+    printf("  greedyMesh:       %8.0f meshes/s\n", meshes / greedyTime);
+    printf("  binaryGreedyMesh: %8.0f meshes/s  %5.2fx\n", meshes / binaryTime, greedyTime / binaryTime);
+    printf("  output %s\n", identical ? "identical" : "MISMATCH");
+
+    //Heap per meshed chunk: the old worst case buffers against exact sized ones
+    int worstQuads = CHUNK_WIDTH * CHUNK_HEIGHT * CHUNK_WIDTH * 6;
+    size_t worstCase = (size_t)worstQuads * 4 * (3 + 3 + 2 + 3) * sizeof(float) + (size_t)worstQuads * 6 * sizeof(unsigned short);
+    size_t terrainBytes = 0;
+    for (int n = 0; n < MESH_BENCH_TERRAIN; n++)
+    {
+        Mesh *parts;
+        int partCount = generateChunkMesh(&snapshots[n], &parts);
+        for (int p = 0; p < partCount; p++)
+        {
+            terrainBytes += meshDataBytes(&parts[p]);
+            UnloadMesh(parts[p]);
+        }
+        MemFree(parts);
+    }
+    printf("  heap per chunk: %.1f KB worst case before, %.1f KB steady state (terrain avg), %.1f KB peak build\n",
+        worstCase / 1024.0, terrainBytes / 1024.0 / MESH_BENCH_TERRAIN, getPeakMeshBuildBytes() / 1024.0);
+
+    //Upload size of the same chunks in the packed vertex format
+    size_t packedBytes = 0;
+    for (int n = 0; n < MESH_BENCH_TERRAIN; n++)
+    {
+        PackedMesh mesh = generatePackedChunkMesh(&snapshots[n]);
+        packedBytes += packedMeshBytes(&mesh);
+        unloadPackedMesh(&mesh);
+    }
+    printf("  upload per chunk: %.1f KB float vertices, %.1f KB packed vertices (%.1fx smaller)\n",
+        terrainBytes / 1024.0 / MESH_BENCH_TERRAIN, packedBytes / 1024.0 / MESH_BENCH_TERRAIN, (double)terrainBytes / packedBytes);
+
+    //Worst case chunks: every float part has to stay inside its 16 bit indices
+    ChunkSnapshot *adversarial = malloc(sizeof(ChunkSnapshot));
+    for (int pattern = 0; pattern < PATTERN_COUNT; pattern++)
+    {
+        fillPattern(adversarial, pattern);
+        reference.count = 0;
+        binaryGreedyMesh(&reference, adversarial);
+
+        Mesh *parts;
+        int partCount = generateChunkMesh(adversarial, &parts);
+        int vertices = 0;
+        bool indicesValid = true;
+        for (int p = 0; p < partCount; p++)
+        {
+            vertices += parts[p].vertexCount;
+            indicesValid = indicesValid && parts[p].vertexCount <= 65536;
+            for (int i = 0; i < parts[p].triangleCount * 3; i++)
+                indicesValid = indicesValid && parts[p].indices[i] < parts[p].vertexCount;
+            UnloadMesh(parts[p]);
+        }
+        MemFree(parts);
+
+        PackedMesh packed = generatePackedChunkMesh(adversarial);
+        printf("  %-12s %6d quads: float %6d vertices in %d parts (indices %s), packed %6d vertices %.1f KB\n",
+            patternNames[pattern], reference.count, vertices, partCount, indicesValid ? "ok" : "OVERFLOW",
+            packed.vertexCount, packedMeshBytes(&packed) / 1024.0);
+        unloadPackedMesh(&packed);
+    }
+    free(adversarial);
+
+    free(reference.quads);
+    free(binary.quads);
+    free(snapshots);
+    freeChunks();
+}
+
+//Frame time for a grid of copies of one chunk, drawn through the same path the game uses
+static double timeChunkDraws(Camera3D camera, Shader shader, const Model *model, const PackedMesh *packed)
+{
+    double start = getWallTime();
+    for (int frame = 0; frame < DRAW_BENCH_FRAMES; frame++)
+    {
+        BeginDrawing();
+            ClearBackground(SKY_COLOR);
+            BeginMode3D(camera);
+                if (packed != NULL) beginPackedDraw(shader, GRAY);
+                for (int cx = 0; cx < DRAW_BENCH_SIDE; cx++)
+                {
+                    for (int cz = 0; cz < DRAW_BENCH_SIDE; cz++)
+                    {
+                        Vector3 chunkPos = (Vector3){cx * CHUNK_WIDTH, 0, cz * CHUNK_WIDTH};
+                        if (packed != NULL) drawPackedMesh(packed, chunkPos);
+                        else DrawModel(*model, chunkPos, 1.0f, GRAY);
+                    }
+                }
+                if (packed != NULL) endPackedDraw();
+            EndMode3D();
+        EndDrawing();
+    }
+    return (getWallTime() - start) * 1000.0 / DRAW_BENCH_FRAMES;
+}
+
+void runDrawBench(void)
+{
+    //Needs a GL context, so unlike the others this one opens a window
+    InitWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Draw benchmark");
+    SetTargetFPS(0);
+    initChunks();
+
+    //Every fog quality for the packed path, FOG_QUALITY for the float one
+    Shader floatShader = loadFogShader("shader/fog.vs", FOG_QUALITY);
+    Shader fogShaders[3];
+    for (int fog = 0; fog < 3; fog++)
+        fogShaders[fog] = loadFogShader("shader/chunk.vs", fog);
+    Shader packedShader = fogShaders[FOG_QUALITY];
+    Shader shaders[4] = { floatShader, fogShaders[0], fogShaders[1], fogShaders[2] };
+    float fogDensity = FOG_VALUE;
+    for (int s = 0; s < 4; s++)
+        SetShaderValue(shaders[s], GetShaderLocation(shaders[s], "fogDensity"), &fogDensity, SHADER_UNIFORM_FLOAT);
+
+    //Looking across the whole grid from one corner
+    float extent = DRAW_BENCH_SIDE * CHUNK_WIDTH;
+    Camera3D camera = {0};
+    camera.position = (Vector3){ -8.0f, CHUNK_HEIGHT + 16.0f, -8.0f };
+    camera.target = (Vector3){ extent * 0.5f, CHUNK_HEIGHT * 0.5f, extent * 0.5f };
+    camera.up = (Vector3){ 0.0f, 1.0f, 0.0f };
+    camera.fovy = CAMERA_FOV;
+    camera.projection = CAMERA_PERSPECTIVE;
+    for (int s = 0; s < 4; s++)
+        SetShaderValue(shaders[s], shaders[s].locs[SHADER_LOC_VECTOR_VIEW], &camera.position.x, SHADER_UNIFORM_VEC3);
+
+    ChunkSnapshot *snapshot = malloc(sizeof(ChunkSnapshot));
+    printf("Draw benchmark: %d x %d copies per frame, %d frames per case\n", DRAW_BENCH_SIDE, DRAW_BENCH_SIDE, DRAW_BENCH_FRAMES);
+    for (int test = -1; test < PATTERN_COUNT; test++)
+    {
+        //-1 is ordinary terrain for scale
+        if (test < 0) snapshotChunk(snapshot, 30, SURFACE_LAYER, 30);
+        else fillPattern(snapshot, test);
+
+        Mesh *parts;
+        int partCount = generateChunkMesh(snapshot, &parts);
+        Model model = loadChunkModel(parts, partCount, floatShader);
+        PackedMesh packed = generatePackedChunkMesh(snapshot);
+        uploadPackedMesh(&packed);
+
+        double floatMs = timeChunkDraws(camera, floatShader, &model, NULL);
+        double packedMs = timeChunkDraws(camera, packedShader, NULL, &packed);
+        printf("  %-12s float %6.2f ms/frame (%d draws/chunk), packed %6.2f ms/frame (1 draw/chunk)\n",
+            test < 0 ? "terrain" : patternNames[test], floatMs, partCount, packedMs);
+        if (test < 0)
+        {
+            double fogMs[3];
+            for (int fog = 0; fog < 3; fog++)
+                fogMs[fog] = timeChunkDraws(camera, fogShaders[fog], NULL, &packed);
+            printf("  %-12s packed fog off %6.2f, per vertex %6.2f, per fragment %6.2f ms/frame\n", "", fogMs[0], fogMs[1], fogMs[2]);
+        }
+
+        UnloadModel(model);
+        unloadPackedMesh(&packed);
+    }
+    free(snapshot);
+
+    UnloadShader(floatShader);
+    for (int fog = 0; fog < 3; fog++)
+        UnloadShader(fogShaders[fog]);
+    freeChunks();
+    CloseWindow();
+}
+
+static float randomRange(uint32_t *seed, float low, float high)
+{
+    *seed = *seed * 1664525u + 1013904223u;
+    return low + (high - low) * ((*seed >> 8) / 16777216.0f);
+}
+
+//Reference answer straight from clip space: inside when -w <= x, y, z <= w
+static bool clipContainsPoint(Matrix m, Vector3 p)
+{
+    float x = m.m0*p.x + m.m4*p.y + m.m8*p.z + m.m12;
+    float y = m.m1*p.x + m.m5*p.y + m.m9*p.z + m.m13;
+    float z = m.m2*p.x + m.m6*p.y + m.m10*p.z + m.m14;
+    float w = m.m3*p.x + m.m7*p.y + m.m11*p.z + m.m15;
+    return -w <= x && x <= w && -w <= y && y <= w && -w <= z && z <= w;
+}
+
+static Camera3D benchCamera(Vector3 position, float yaw, float pitch)
+{
+    Camera3D camera = {0};
+    camera.position = position;
+    camera.target = (Vector3){ position.x + cosf(pitch) * cosf(yaw), position.y + sinf(pitch), position.z + cosf(pitch) * sinf(yaw) };
+    camera.up = (Vector3){ 0.0f, 1.0f, 0.0f };
+    camera.fovy = CAMERA_FOV;
+    camera.projection = CAMERA_PERSPECTIVE;
+    return camera;
+}
+
+void runFrustumBench(void)
+{
+    float aspect = (float)SCREEN_WIDTH / SCREEN_HEIGHT;
+    uint32_t seed = 777;
+    int pointMismatches = 0, missedBoxes = 0, keptBoxes = 0;
+
+    //Correctness against clip space: sampled points must agree and no box with a point in view may be culled
+    for (int c = 0; c < FRUSTUM_BENCH_CAMERAS; c++)
+    {
+        Vector3 eye = { randomRange(&seed, -50, 50), randomRange(&seed, 0, 100), randomRange(&seed, -50, 50) };
+        Camera3D camera = benchCamera(eye, randomRange(&seed, 0, 2 * PI), randomRange(&seed, -1.4f, 1.4f));
+        Matrix viewProjection = cameraViewProjection(camera, aspect);
+        Frustum frustum = frustumFromCamera(camera, aspect);
+
+        for (int b = 0; b < FRUSTUM_BENCH_BOXES; b++)
+        {
+            Vector3 min = { eye.x + randomRange(&seed, -200, 200), eye.y + randomRange(&seed, -200, 200), eye.z + randomRange(&seed, -200, 200) };
+            Vector3 size = { randomRange(&seed, 0.5f, 32), randomRange(&seed, 0.5f, 64), randomRange(&seed, 0.5f, 32) };
+            BoundingBox box = { min, (Vector3){ min.x + size.x, min.y + size.y, min.z + size.z } };
+
+            bool anyInside = false;
+            for (int i = 0; i <= 4; i++)
+                for (int j = 0; j <= 4; j++)
+                    for (int k = 0; k <= 4; k++)
+                    {
+                        Vector3 p = { min.x + size.x * i / 4, min.y + size.y * j / 4, min.z + size.z * k / 4 };
+                        bool inside = clipContainsPoint(viewProjection, p);
+                        if (inside != frustumContainsPoint(&frustum, p)) pointMismatches++;
+                        anyInside = anyInside || inside;
+                    }
+            bool kept = frustumContainsBox(&frustum, box);
+            if (anyInside && !kept) missedBoxes++;
+            keptBoxes += kept;
+        }
+    }
+    int boxes = FRUSTUM_BENCH_CAMERAS * FRUSTUM_BENCH_BOXES;
+    printf("Frustum benchmark\n");
+    printf("  %d random boxes: %d kept, %d visible boxes culled, %d of %d point tests disagree with clip space\n",
+        boxes, keptBoxes, missedBoxes, pointMismatches, boxes * 125);
+
+    //Share of the render square a player standing on the terrain actually draws, turning in place
+    int side = 2 * DEFAULT_RENDER_DISTANCE + 1;
+    float center = DEFAULT_RENDER_DISTANCE * CHUNK_WIDTH + CHUNK_WIDTH * 0.5f;
+    int tested = 0, drawn = 0;
+    double start = getWallTime();
+    for (int turn = 0; turn < 360; turn++)
+    {
+        Camera3D camera = benchCamera((Vector3){ center, CHUNK_HEIGHT * 0.6f, center }, turn * DEG2RAD, -0.2f);
+        Frustum frustum = frustumFromCamera(camera, aspect);
+        for (int cx = 0; cx < side; cx++)
+            for (int cz = 0; cz < side; cz++)
+            {
+                BoundingBox box = { (Vector3){ cx * CHUNK_WIDTH, 0, cz * CHUNK_WIDTH },
+                    (Vector3){ (cx + 1) * CHUNK_WIDTH, CHUNK_HEIGHT, (cz + 1) * CHUNK_WIDTH } };
+                drawn += frustumContainsBox(&frustum, box);
+                tested++;
+            }
+    }
+    double elapsed = getWallTime() - start;
+    printf("  render distance %d: %.1f of %d chunks drawn per frame on average (%.0f%%), %.1f ns per box\n",
+        DEFAULT_RENDER_DISTANCE, (double)drawn / 360, side * side, 100.0 * drawn / tested, elapsed * 1e9 / tested);
+}
+
+//Connectivity for every chunk in the square, the same thing the mesh jobs store on upload
+static void updateSquareVisibility(int pcx, int pcz, int radius)
+{
+    ChunkSnapshot *snapshot = malloc(sizeof(ChunkSnapshot));
+    for (int cx = pcx - radius; cx <= pcx + radius; cx++)
+        for (int cz = pcz - radius; cz <= pcz + radius; cz++)
+            for (int cy = 0; cy < WORLD_HEIGHT_CHUNKS; cy++)
+            {
+                snapshotChunk(snapshot, cx, cy, cz);
+                Chunk *chunk = getChunk(cx, cy, cz);
+                chunk->visibility = computeFaceConnectivity(snapshot);
+                chunk->meshed = true;
+                chunk->meshVersion++;
+            }
+    free(snapshot);
+}
+
+static void carveBox(int x0, int y0, int z0, int x1, int y1, int z1)
+{
+    for (int x = x0; x <= x1; x++)
+        for (int y = y0; y <= y1; y++)
+            for (int z = z0; z <= z1; z++)
+                setChunkBlock(getChunk(x / CHUNK_WIDTH, y / CHUNK_HEIGHT, z / CHUNK_WIDTH), x % CHUNK_WIDTH, y % CHUNK_HEIGHT, z % CHUNK_WIDTH, AIR);
+}
+
+static void reportCullPose(const char *name, Vector3 position, int pcx, int pcz, int radius)
+{
+    Camera3D camera = benchCamera(position, 0.0f, -0.2f);
+    Frustum frustum = frustumFromCamera(camera, (float)SCREEN_WIDTH / SCREEN_HEIGHT);
+
+    //First walk includes the camera chunk flood, later ones reuse it until the camera cell changes
+    double start = getWallTime();
+    unsigned int stamp = findVisibleChunks(position, radius);
+    double first = getWallTime() - start;
+    start = getWallTime();
+    for (int repeat = 0; repeat < 100; repeat++)
+        stamp = findVisibleChunks(position, radius);
+    double steady = (getWallTime() - start) / 100;
+
+    int total = 0, reachable = 0, inFrustum = 0, drawn = 0;
+    for (int cx = pcx - radius; cx <= pcx + radius; cx++)
+        for (int cz = pcz - radius; cz <= pcz + radius; cz++)
+            for (int cy = 0; cy < WORLD_HEIGHT_CHUNKS; cy++)
+            {
+                const Chunk *chunk = findChunk(cx, cy, cz);
+                bool open = chunk->visibleStamp == stamp;
+                bool inView = frustumContainsBox(&frustum, getChunkBounds(chunk));
+                total++;
+                reachable += open;
+                inFrustum += inView;
+                drawn += open && inView;
+            }
+    printf("  %-12s %3d of %d reachable (%3.0f%% occluded), frustum only %3d, both %3d (%3.0f%% culled), walk %.3f ms first, %.3f ms after\n",
+        name, reachable, total, 100.0 * (total - reachable) / total, inFrustum, drawn, 100.0 * (total - drawn) / total, first * 1000.0, steady * 1000.0);
+}
+
+void runCullBench(void)
+{
+    initChunks();
+    int radius = DEFAULT_RENDER_DISTANCE;
+    int pcx = SPAWN_CHUNK, pcz = SPAWN_CHUNK;
+    updateSquareVisibility(pcx, pcz, radius);
+
+    //Deepest column in the middle chunk for the underground poses
+    int bestX = 0, bestZ = 0, bestHeight = -1;
+    for (int x = 2; x < CHUNK_WIDTH - 2; x++)
+        for (int z = 2; z < CHUNK_WIDTH - 2; z++)
+        {
+            int height = 0;
+            while (height < WORLD_HEIGHT && getBlockAtWorld(pcx * CHUNK_WIDTH + x, height, pcz * CHUNK_WIDTH + z) != AIR) height++;
+            if (height > bestHeight) { bestHeight = height; bestX = x; bestZ = z; }
+        }
+    int wx = pcx * CHUNK_WIDTH + bestX, wz = pcz * CHUNK_WIDTH + bestZ;
+    Vector3 center = (Vector3){ wx + 0.5f, 0, wz + 0.5f };
+
+    printf("Cull benchmark: render distance %d, camera chunk %d,%d\n", radius, pcx, pcz);
+    center.y = bestHeight + 2.0f;
+    reportCullPose("surface", center, pcx, pcz, radius);
+    center.y = WORLD_HEIGHT + 100.0f;
+    reportCullPose("sky", center, pcx, pcz, radius);
+
+    //A sealed 3 x 3 x 3 room at the bottom, then a tunnel from it along the always solid bottom row through the next few chunks
+    int roomY = 1;
+    carveBox(wx - 1, roomY - 1, wz - 1, wx + 1, roomY + 1, wz + 1);
+    updateSquareVisibility(pcx, pcz, radius);
+    center.y = roomY + 0.5f;
+    reportCullPose("sealed room", center, pcx, pcz, radius);
+
+    carveBox(wx, 0, wz, wx + 4 * CHUNK_WIDTH, 0, wz);
+    updateSquareVisibility(pcx, pcz, radius);
+    reportCullPose("tunnel", center, pcx, pcz, radius);
+
+    freeChunks();
+}
+
+//Runs queued loads/unloads until both queues are empty, returns the frame count and the slowest frame
+static int drainChunkQueues(double *worstFrame)
+{
+    int frames = 0;
+    while (getQueuedChunkLoads() > 0 || getQueuedChunkUnloads() > 0)
+    {
+        double start = getWallTime();
+        processChunkQueues(CHUNK_LOADS_PER_FRAME, CHUNK_UNLOADS_PER_FRAME);
+        double elapsed = getWallTime() - start;
+        if (elapsed > *worstFrame) *worstFrame = elapsed;
+        frames++;
+    }
+    return frames;
+}
+
+void runRingBench(void)
+{
+    static const int radii[] = { 4, 10, 16, 32 };
+    static const int stepX[4] = { 1, 0, -1, 0 };
+    static const int stepZ[4] = { 0, 1, 0, -1 };
+
+    printf("Resident ring benchmark: %d border crossings per run, %d loads / %d unloads per frame\n",
+        4 * RING_BENCH_LEG, CHUNK_LOADS_PER_FRAME, CHUNK_UNLOADS_PER_FRAME);
+    int savedDistance = currentRenderDistance;
+    for (int r = 0; r < (int)(sizeof(radii) / sizeof(radii[0])); r++)
+    {
+        //Meshes are built but never uploaded, the finished jobs are dropped at shutdown
+        currentRenderDistance = radii[r];
+        initChunks();
+        initMeshJobs(MESH_WORKER_THREADS);
+
+        int pcx = SPAWN_CHUNK, pcz = SPAWN_CHUNK;
+        updateVisibleChunks((Vector3){ pcx, 0, pcz });
+        double worstFrame = 0.0;
+        drainChunkQueues(&worstFrame);
+
+        //Walk a square loop, one chunk per crossing. Only the rings that can cross a LOD edge are checked for a new level
+        double deltaTime = 0.0;
+        worstFrame = 0.0;
+        long long checkedBefore = getLodColumnsChecked();
+        for (int leg = 0; leg < 4; leg++)
+        {
+            for (int step = 0; step < RING_BENCH_LEG; step++)
+            {
+                pcx += stepX[leg];
+                pcz += stepZ[leg];
+                double start = getWallTime();
+                updateVisibleChunks((Vector3){ pcx, 0, pcz });
+                deltaTime += getWallTime() - start;
+                drainChunkQueues(&worstFrame);
+            }
+        }
+        int crossings = 4 * RING_BENCH_LEG;
+        double checked = (double)(getLodColumnsChecked() - checkedBefore) / crossings;
+        int side = 2 * radii[r] + 1;
+        int afterWalk = getResidentChunkCount();
+
+        //Teleport far away: nothing is loaded synchronously, the queues spread it over frames and evict the old square
+        double teleportWorst = 0.0;
+        double start = getWallTime();
+        updateVisibleChunks((Vector3){ pcx + 100000, 0, pcz - 100000 });
+        double teleportTime = getWallTime() - start;
+        int teleportFrames = drainChunkQueues(&teleportWorst);
+
+        printf("  render distance %2d: crossing %6.3f ms, worst frame %5.2f ms, %4d chunks resident; teleport %.3f ms + %d frames (worst %.2f ms), %4d resident\n",
+            radii[r], deltaTime * 1000.0 / crossings, worstFrame * 1000.0, afterWalk,
+            teleportTime * 1000.0, teleportFrames, teleportWorst * 1000.0, getResidentChunkCount());
+        printf("                      LOD levels checked for %.0f columns per crossing of the %d in the square (%.1f%%)\n",
+            checked, side * side, 100.0 * checked / (side * side));
+
+        shutdownMeshJobs();
+        freeChunks();
+    }
+    currentRenderDistance = savedDistance;
+}
+
+void runMapBench(void)
+{
+    //Old layout: one contiguous row of chunks per x column, indexed [cx][cy][cz]
+    int side = MAP_BENCH_SIDE;
+    Chunk ***array = malloc(side * sizeof(Chunk **));
+    ChunkMap map;
+    initChunkMap(&map, 16);
+    for (int cx = 0; cx < side; cx++)
+    {
+        array[cx] = malloc(sizeof(Chunk *));
+        array[cx][0] = calloc(side, sizeof(Chunk));
+        for (int cz = 0; cz < side; cz++)
+            chunkMapInsert(&map, packChunkKey(cx, 0, cz), &array[cx][0][cz]);
+    }
+
+    //Random chunks, and runs of lookups in one chunk like a raycast or neighbour reads
+    int *coords = malloc(MAP_BENCH_LOOKUPS * 2 * sizeof(int));
+    uint32_t seed = 99;
+    for (int pattern = 0; pattern < 2; pattern++)
+    {
+        int run = (pattern == 0) ? 1 : 32;
+        for (int i = 0; i < MAP_BENCH_LOOKUPS; i += run)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            int cx = (seed >> 8) % side;
+            seed = seed * 1664525u + 1013904223u;
+            int cz = (seed >> 8) % side;
+            for (int j = i; j < i + run && j < MAP_BENCH_LOOKUPS; j++)
+            {
+                coords[j * 2] = cx;
+                coords[j * 2 + 1] = cz;
+            }
+        }
+
+        volatile uintptr_t sink = 0;
+        double start = getWallTime();
+        for (int i = 0; i < MAP_BENCH_LOOKUPS; i++)
+        {
+            int cx = coords[i * 2], cz = coords[i * 2 + 1];
+            if (cx < 0 || cx >= side || cz < 0 || cz >= side) continue;
+            sink += (uintptr_t)&array[cx][0][cz];
+        }
+        double arrayTime = getWallTime() - start;
+
+        start = getWallTime();
+        for (int i = 0; i < MAP_BENCH_LOOKUPS; i++)
+            sink += (uintptr_t)chunkMapProbe(&map, packChunkKey(coords[i * 2], 0, coords[i * 2 + 1]));
+        double probeTime = getWallTime() - start;
+
+        start = getWallTime();
+        for (int i = 0; i < MAP_BENCH_LOOKUPS; i++)
+            sink += (uintptr_t)chunkMapGet(&map, packChunkKey(coords[i * 2], 0, coords[i * 2 + 1]));
+        double cachedTime = getWallTime() - start;
+
+        if (pattern == 0) printf("Chunk lookup benchmark: %d x %d chunks, %d lookups per pattern\n", side, side, MAP_BENCH_LOOKUPS);
+        printf("  %-14s array %5.2f ns, hash map %5.2f ns, hash map + cache %5.2f ns\n", pattern == 0 ? "random:" : "runs of 32:",
+            arrayTime * 1e9 / MAP_BENCH_LOOKUPS, probeTime * 1e9 / MAP_BENCH_LOOKUPS, cachedTime * 1e9 / MAP_BENCH_LOOKUPS);
+    }
+
+    free(coords);
+    freeChunkMap(&map);
+    for (int cx = 0; cx < side; cx++)
+    {
+        free(array[cx][0]);
+        free(array[cx]);
+    }
+    free(array);
+}
+
+void runHeightBench(void)
+{
+    initChunks();
+    int x0 = SPAWN_CHUNK, z0 = SPAWN_CHUNK;
+    //One extra ring so the sealed checks see every neighbour
+    for (int cx = x0 - 1; cx <= x0 + HEIGHT_BENCH_SIDE; cx++)
+        for (int cz = z0 - 1; cz <= z0 + HEIGHT_BENCH_SIDE; cz++)
+            for (int cy = 0; cy < WORLD_HEIGHT_CHUNKS; cy++)
+                getChunk(cx, cy, cz);
+
+    printf("Height benchmark: %d x %d columns, %d layers of %d blocks (%d tall)\n",
+        HEIGHT_BENCH_SIDE, HEIGHT_BENCH_SIDE, WORLD_HEIGHT_CHUNKS, CHUNK_HEIGHT, WORLD_HEIGHT);
+    ChunkSnapshot *snapshot = malloc(sizeof(ChunkSnapshot));
+    size_t totalBytes = 0;
+    long long totalQuads = 0;
+    double meshedTime = 0.0, everyTime = 0.0;
+    for (int cy = WORLD_HEIGHT_CHUNKS - 1; cy >= 0; cy--)
+    {
+        int air = 0, sealed = 0, meshed = 0;
+        long long quads = 0;
+        size_t bytes = 0;
+        double layerTime = 0.0, skippedTime = 0.0;
+        for (int cx = x0; cx < x0 + HEIGHT_BENCH_SIDE; cx++)
+            for (int cz = z0; cz < z0 + HEIGHT_BENCH_SIDE; cz++)
+            {
+                const Chunk *chunk = findChunk(cx, cy, cz);
+                for (int s = 0; s < CHUNK_SECTIONS; s++)
+                    bytes += sectionMemoryBytes(&chunk->sections[s]);
+
+                //Skipped chunks are still meshed here to show what they would have cost
+                uint16_t visibility;
+                bool skip = chunkHasNoFaces(chunk, &visibility);
+                double start = getWallTime();
+                snapshotChunk(snapshot, cx, cy, cz);
+                PackedMesh mesh = generatePackedChunkMesh(snapshot);
+                double elapsed = getWallTime() - start;
+                quads += mesh.vertexCount / PACKED_VERTICES_PER_QUAD;
+                unloadPackedMesh(&mesh);
+
+                if (!skip)
+                {
+                    layerTime += elapsed;
+                    meshed++;
+                }
+                else
+                {
+                    skippedTime += elapsed;
+                    if (visibility == VISIBILITY_ALL) air++;
+                    else sealed++;
+                }
+            }
+        printf("  layer %d: %3d meshed, %3d all air, %3d sealed solid, %6lld quads, %7.1f KB blocks, mesh %6.2f ms (%6.2f ms without skips)\n",
+            cy, meshed, air, sealed, quads, bytes / 1024.0, layerTime * 1000.0, (layerTime + skippedTime) * 1000.0);
+        totalBytes += bytes;
+        totalQuads += quads;
+        meshedTime += layerTime;
+        everyTime += layerTime + skippedTime;
+    }
+    int columns = HEIGHT_BENCH_SIDE * HEIGHT_BENCH_SIDE;
+    printf("  per column: %.1f KB blocks (%zu bytes as plain bytes), %.1f quads, mesh %.3f ms (%.3f ms meshing every layer)\n",
+        totalBytes / 1024.0 / columns, (size_t)WORLD_HEIGHT * CHUNK_WIDTH * CHUNK_WIDTH, (double)totalQuads / columns,
+        meshedTime * 1000.0 / columns, everyTime * 1000.0 / columns);
+    free(snapshot);
+    freeChunks();
+}
+
+static int regionOf(int c)
+{
+    return (c < 0) ? -((-c + REGION_SIZE - 1) / REGION_SIZE) : c / REGION_SIZE;
+}
+
+//Size of the region files the bench wrote for a side x side square, removed afterwards when asked
+static size_t regionFileBytes(int side, int *files, bool removeFiles)
+{
+    size_t bytes = 0;
+    char path[512];
+    *files = 0;
+    for (int rx = regionOf(-side / 2); rx <= regionOf(side - 1 - side / 2); rx++)
+        for (int rz = regionOf(-side / 2); rz <= regionOf(side - 1 - side / 2); rz++)
+        {
+            snprintf(path, sizeof(path), "%s/r.%d.%d.bin", REGION_BENCH_DIRECTORY, rx, rz);
+            FILE *file = fopen(path, "rb");
+            if (file == NULL) continue;
+            fseek(file, 0, SEEK_END);
+            bytes += (size_t)ftell(file);
+            fclose(file);
+            if (removeFiles) remove(path);
+            (*files)++;
+        }
+    return bytes;
+}
+
+//A few random blocks knocked out of every 8th chunk so the payloads are not all plain terrain
+static void scatterEdits(Chunk *chunks, int count, uint32_t *seed)
+{
+    for (int i = 0; i < count; i += 8)
+        for (int e = 0; e < 64; e++)
+        {
+            *seed = *seed * 1664525u + 1013904223u;
+            uint32_t r = *seed >> 8;
+            setChunkBlock(&chunks[i], r % CHUNK_WIDTH, (r / CHUNK_WIDTH) % CHUNK_HEIGHT, (r / (CHUNK_WIDTH * CHUNK_HEIGHT)) % CHUNK_WIDTH, (e & 1) ? AIR : SOLID);
+            chunks[i].modified = true;
+        }
+}
+
+static uint64_t hashChunks(const Chunk *chunks, int count)
+{
+    uint64_t hash = 1469598103934665603ULL;
+    for (int i = 0; i < count; i++)
+        hash = hashChunkBlocks(hash, &chunks[i]);
+    return hash;
+}
+
+//Fresh chunks filled from the region files, false if any was missing
+static bool loadBenchChunks(Chunk *chunks, const ChunkGenTask *tasks, int count)
+{
+    bool all = true;
+    for (int i = 0; i < count; i++)
+    {
+        resetChunk(&chunks[i]);
+        chunks[i].cx = tasks[i].cx;
+        chunks[i].cy = tasks[i].cy;
+        chunks[i].cz = tasks[i].cz;
+        all = loadChunkFromRegion(&chunks[i], tasks[i].cx, tasks[i].cy, tasks[i].cz) && all;
+    }
+    return all;
+}
+
+void runRegionBench(void)
+{
+    static const int sides[] = { 8, 32, 64 };
+    printf("Region benchmark: %d layers per column, %d x %d columns per region file, single thread\n",
+        WORLD_HEIGHT_CHUNKS, REGION_SIZE, REGION_SIZE);
+    uint32_t seed = 777;
+    for (int run = 0; run < (int)(sizeof(sides) / sizeof(sides[0])); run++)
+    {
+        //Centred on the origin so negative region coordinates are covered too
+        int side = sides[run];
+        int count = side * side * WORLD_HEIGHT_CHUNKS;
+        Chunk *chunks = calloc(count, sizeof(Chunk));
+        ChunkGenTask *tasks = malloc(count * sizeof(ChunkGenTask));
+        for (int i = 0; i < count; i++)
+        {
+            int column = i / WORLD_HEIGHT_CHUNKS;
+            tasks[i] = (ChunkGenTask){ &chunks[i], column % side - side / 2, i % WORLD_HEIGHT_CHUNKS, column / side - side / 2 };
+            chunks[i].cx = tasks[i].cx;
+            chunks[i].cy = tasks[i].cy;
+            chunks[i].cz = tasks[i].cz;
+        }
+
+        //Regions are not running yet, so this is plain generation
+        double start = getWallTime();
+        generateChunks(NULL, tasks, count);
+        double genTime = getWallTime() - start;
+        scatterEdits(chunks, count, &seed);
+        uint64_t original = hashChunks(chunks, count);
+        size_t memoryBytes = 0;
+        for (int i = 0; i < count; i++)
+            for (int s = 0; s < CHUNK_SECTIONS; s++)
+                memoryBytes += sectionMemoryBytes(&chunks[i].sections[s]);
+
+        initRegions(REGION_BENCH_DIRECTORY);
+        start = getWallTime();
+        for (int i = 0; i < count; i++)
+            saveChunkToRegion(&chunks[i]);
+        double encodeTime = getWallTime() - start;
+        submitRegionWrites();
+        flushRegionWrites();
+        double saveTime = getWallTime() - start;
+        RegionStats stats = getRegionStats();
+
+        start = getWallTime();
+        bool complete = loadBenchChunks(chunks, tasks, count);
+        double loadTime = getWallTime() - start;
+        bool identical = complete && hashChunks(chunks, count) == original;
+
+        int files;
+        size_t fileBytes = regionFileBytes(side, &files, false);
+
+        //More rounds: edits saved over the old payloads, most of them outgrowing their sectors, then read back
+        bool rewritten = true;
+        for (int round = 0; round < REGION_BENCH_REWRITES; round++)
+        {
+            scatterEdits(chunks, count, &seed);
+            uint64_t edited = hashChunks(chunks, count);
+            for (int i = 0; i < count; i++)
+                if (chunks[i].modified) saveChunkToRegion(&chunks[i]);
+            submitRegionWrites();
+            flushRegionWrites();
+            rewritten = loadBenchChunks(chunks, tasks, count) && hashChunks(chunks, count) == edited && rewritten;
+        }
+        shutdownRegions();
+        size_t rewrittenBytes = regionFileBytes(side, &files, true);
+
+        printf("  %2d x %2d columns, %5d chunks in %d files:\n", side, side, count, files);
+        printf("    save  %7.2f ms (%.2f encode), %6.1f MB/s, %.0f bytes/chunk payload vs %.0f in memory, %.1f MB on disk, %.1f MB after %d rewrites\n",
+            saveTime * 1000.0, encodeTime * 1000.0, stats.bytesWritten / saveTime / (1024.0 * 1024.0),
+            (double)stats.bytesWritten / count, (double)memoryBytes / count, fileBytes / (1024.0 * 1024.0),
+            rewrittenBytes / (1024.0 * 1024.0), REGION_BENCH_REWRITES);
+        printf("    load  %9.0f chunks/s vs generate %9.0f chunks/s (%.2fx), round trip %s, rewrites %s\n",
+            count / loadTime, count / genTime, genTime / loadTime, identical ? "identical" : "MISMATCH", rewritten ? "identical" : "MISMATCH");
+
+        for (int i = 0; i < count; i++)
+            resetChunk(&chunks[i]);
+        free(tasks);
+        free(chunks);
+    }
+    removeDirectory(REGION_BENCH_DIRECTORY);
+}
+
+//Every layer of a square of columns through the same steps as a mesh job, returns the time taken
+static double meshAreaThroughCache(int x0, int z0, long long *hits, long long *builds)
+{
+    ChunkSnapshot *snapshot = malloc(sizeof(ChunkSnapshot));
+    double start = getWallTime();
+    for (int cx = x0; cx < x0 + MESH_CACHE_BENCH_SIDE; cx++)
+        for (int cz = z0; cz < z0 + MESH_CACHE_BENCH_SIDE; cz++)
+            for (int cy = 0; cy < WORLD_HEIGHT_CHUNKS; cy++)
+            {
+                uint16_t visibility;
+                if (chunkHasNoFaces(getChunk(cx, cy, cz), &visibility)) continue;
+                snapshotChunk(snapshot, cx, cy, cz);
+                uint64_t key = packChunkKey(cx, cy, cz);
+                uint64_t hash = hashSnapshot(snapshot);
+                CachedMesh cached;
+                if (fetchCachedMesh(key, hash, &cached))
+                {
+                    MemFree(cached.vertices);
+                    (*hits)++;
+                    continue;
+                }
+                int minY = 0, maxY = 0;
+                snapshotOccupiedRows(snapshot, &minY, &maxY);
+                PackedMesh mesh = generatePackedChunkMesh(snapshot);
+                CachedMesh built = { mesh.vertices, mesh.vertexCount, minY, maxY, computeFaceConnectivity(snapshot) };
+                storeCachedMesh(key, hash, &built);
+                unloadPackedMesh(&mesh);
+                (*builds)++;
+            }
+    free(snapshot);
+    return getWallTime() - start;
+}
+
+void runMeshCacheBench(void)
+{
+    initChunks();
+    int ax = SPAWN_CHUNK, az = SPAWN_CHUNK;
+    int bx = SPAWN_CHUNK + 100, bz = SPAWN_CHUNK;
+    makeDirectory(REGION_BENCH_DIRECTORY);
+    const char *spillPath = REGION_BENCH_DIRECTORY "/meshes.cache";
+
+    //Size of both areas' meshes, the budgets below are fractions of it
+    long long hits = 0, builds = 0;
+    initMeshCache((size_t)-1, NULL);
+    meshAreaThroughCache(ax, az, &hits, &builds);
+    meshAreaThroughCache(bx, bz, &hits, &builds);
+    size_t workingSet = getMeshCacheStats().bytes;
+    shutdownMeshCache();
+    printf("Mesh cache benchmark: two areas of %d x %d columns, visited A, B, then A again. Both need %.1f MB\n",
+        MESH_CACHE_BENCH_SIDE, MESH_CACHE_BENCH_SIDE, workingSet / (1024.0 * 1024.0));
+
+    struct { const char *name; size_t budget; bool spill; } cases[] = {
+        { "off", 0, false },
+        { "all fits", workingSet, false },
+        { "half", workingSet / 2, false },
+        { "half+spill", workingSet / 2, true },
+        { "quarter+spill", workingSet / 4, true },
+    };
+    for (int c = 0; c < (int)(sizeof(cases) / sizeof(cases[0])); c++)
+    {
+        initMeshCache(cases[c].budget, cases[c].spill ? spillPath : NULL);
+        hits = builds = 0;
+        double cold = meshAreaThroughCache(ax, az, &hits, &builds);
+        meshAreaThroughCache(bx, bz, &hits, &builds);
+        hits = builds = 0;
+        double back = meshAreaThroughCache(ax, az, &hits, &builds);
+        MeshCacheStats stats = getMeshCacheStats();
+        printf("  %-14s first visit %7.2f ms, return %7.2f ms (%5.1fx), %4lld hits %4lld rebuilt (%3.0f%% spill), %5.1f MB in memory\n",
+            cases[c].name, cold * 1000.0, back * 1000.0, cold / back, hits, builds,
+            hits ? 100.0 * stats.spillHits / hits : 0.0, stats.bytes / (1024.0 * 1024.0));
+        shutdownMeshCache();
+    }
+    removeDirectory(REGION_BENCH_DIRECTORY);
+    freeChunks();
+}
+
+typedef enum EditMode {
+    EDIT_FLUSH_EACH,    //setBlockAtWorld then a flush per block, what one rebuild per write costs
+    EDIT_FLUSH_ONCE,    //setBlockAtWorld per block, one flush at the end
+    EDIT_BULK,          //carveSphere / fillRegion, one flush
+    EDIT_MODE_COUNT
+} EditMode;
+
+static const char *editModeNames[EDIT_MODE_COUNT] = { "flush per block", "flush once", "bulk call" };
+
+static uint64_t hashWorldBox(int x0, int y0, int z0, int x1, int y1, int z1)
+{
+    uint64_t hash = 1469598103934665603ULL;
+    for (int x = x0; x <= x1; x++)
+        for (int y = y0; y <= y1; y++)
+            for (int z = z0; z <= z1; z++)
+            {
+                uint8_t block = (uint8_t)getBlockAtWorld(x, y, z);
+                hash = hashBytes(hash, &block, 1);
+            }
+    return hash;
+}
+
+//One edit on a freshly loaded square. Returns the time, rebuild requests and a hash of the result
+static double runEdit(EditMode mode, bool sphere, int *requests, uint64_t *result)
+{
+    initChunks();
+    initMeshJobs(MESH_WORKER_THREADS);
+    updateVisibleChunks((Vector3){ SPAWN_CHUNK, 0, SPAWN_CHUNK });
+    double worstFrame = 0.0;
+    drainChunkQueues(&worstFrame);
+
+    //Centred on the corner of four chunks and just above a layer border, the carve in rock and the fill in the air
+    int r = EDIT_BENCH_RADIUS;
+    int wx = SPAWN_CHUNK * CHUNK_WIDTH, wy = (sphere ? 1 : 2) * CHUNK_HEIGHT + 4, wz = SPAWN_CHUNK * CHUNK_WIDTH;
+    *requests = 0;
+    double start = getWallTime();
+    if (mode == EDIT_BULK)
+    {
+        if (sphere) carveSphere(wx, wy, wz, r);
+        else fillRegion(wx - r, wy - r, wz - r, wx + r, wy + r, wz + r, SOLID);
+    }
+    else
+    {
+        for (int x = wx - r; x <= wx + r; x++)
+            for (int y = wy - r; y <= wy + r; y++)
+                for (int z = wz - r; z <= wz + r; z++)
+                {
+                    int dx = x - wx, dy = y - wy, dz = z - wz;
+                    if (sphere && dx * dx + dy * dy + dz * dz > r * r) continue;
+                    setBlockAtWorld(x, y, z, sphere ? AIR : SOLID, FACE_NONE);
+                    if (mode == EDIT_FLUSH_EACH) *requests += flushDirtyChunks();
+                }
+    }
+    *requests += flushDirtyChunks();
+    double elapsed = getWallTime() - start;
+
+    *result = hashWorldBox(wx - r, wy - r, wz - r, wx + r, wy + r, wz + r);
+    shutdownMeshJobs();
+    freeChunks();
+    return elapsed;
+}
+
+void runEditBench(void)
+{
+    printf("Edit benchmark: radius %d sphere carve and %d^3 box fill at a chunk corner, edit plus rebuild requests\n",
+        EDIT_BENCH_RADIUS, 2 * EDIT_BENCH_RADIUS + 1);
+    int savedDistance = currentRenderDistance;
+    currentRenderDistance = 4;
+    for (int shape = 0; shape < 2; shape++)
+    {
+        uint64_t reference = 0;
+        for (int mode = 0; mode < EDIT_MODE_COUNT; mode++)
+        {
+            int requests;
+            uint64_t result;
+            double elapsed = runEdit(mode, shape == 0, &requests, &result);
+            if (mode == 0) reference = result;
+            printf("  %-6s %-16s %8.2f ms, %5d rebuilds requested  %s\n", shape == 0 ? "sphere" : "box",
+                editModeNames[mode], elapsed * 1000.0, requests, result == reference ? "same blocks" : "MISMATCH");
+        }
+    }
+    currentRenderDistance = savedDistance;
+}
+
+void runTerrainBench(void)
+{
+    //Heights only, one thread, straight from the generators so the column cache stays out of it
+    const TerrainGenerator *generators[] = { &sineTerrain, &perlinTerrain, &perlinTerrainSimd };
+    int generatorCount = sizeof(generators) / sizeof(generators[0]);
+    int count = TERRAIN_BENCH_SIDE * TERRAIN_BENCH_SIDE;
+    ColumnHeights *results[3];
+    printf("Terrain benchmark: %d block columns per generator, seed %u\n", count * CHUNK_WIDTH * CHUNK_WIDTH, TERRAIN_SEED);
+
+    for (int g = 0; g < generatorCount; g++)
+    {
+        results[g] = malloc(count * sizeof(ColumnHeights));
+        double start = getWallTime();
+        for (int i = 0; i < count; i++)
+            generators[g]->fillHeights(TERRAIN_SEED, i / TERRAIN_BENCH_SIDE, i % TERRAIN_BENCH_SIDE, &results[g][i]);
+        double elapsed = getWallTime() - start;
+
+        int lowest = WORLD_HEIGHT, highest = 0;
+        for (int i = 0; i < count; i++)
+        {
+            if (results[g][i].lowest < lowest) lowest = results[g][i].lowest;
+            if (results[g][i].highest > highest) highest = results[g][i].highest;
+        }
+        printf("  %-24s %12.0f columns/s  heights %3d..%3d\n", generators[g]->name,
+            count * CHUNK_WIDTH * CHUNK_WIDTH / elapsed, lowest, highest);
+    }
+
+    //The SIMD path has to build the same world as the scalar one
+    int mismatched = 0;
+    for (int i = 0; i < count; i++)
+        if (memcmp(results[1][i].heights, results[2][i].heights, sizeof(results[1][i].heights)) != 0) mismatched++;
+    printf("  %s (%d of %d chunk columns differ)\n", mismatched == 0 ? "scalar and simd identical" : "scalar and simd MISMATCH",
+        mismatched, count);
+
+    for (int g = 0; g < generatorCount; g++)
+        free(results[g]);
+}
+
+static uint64_t hashTaskChunks(const ChunkGenTask *tasks, int count)
+{
+    uint64_t hash = 1469598103934665603ULL;
+    for (int i = 0; i < count; i++)
+        hash = hashChunkBlocks(hash, tasks[i].chunk);
+    return hash;
+}
+
+void runFeatureBench(void)
+{
+    //Every layer of a square of columns, chunks outside the world map
+    int count = FEATURE_BENCH_SIDE * FEATURE_BENCH_SIDE * WORLD_HEIGHT_CHUNKS;
+    Chunk *benchChunks = calloc(count, sizeof(Chunk));
+    ChunkGenTask *tasks = malloc(count * sizeof(ChunkGenTask));
+    for (int i = 0; i < count; i++)
+    {
+        int column = i / WORLD_HEIGHT_CHUNKS;
+        tasks[i] = (ChunkGenTask){ &benchChunks[i], column / FEATURE_BENCH_SIDE, i % WORLD_HEIGHT_CHUNKS, column % FEATURE_BENCH_SIDE };
+    }
+    printf("Feature benchmark: %d chunks, %d tree spots per column at %d%%\n", count, TERRAIN_TREE_SITES, TERRAIN_TREE_CHANCE);
+
+    //Heights are forgotten before every pass so each one pays for them
+    const TerrainGenerator *generator = getTerrainGenerator();
+    uint32_t seed = getTerrainSeed();
+
+    setTerrainGenerator(generator, seed);
+    double start = getWallTime();
+    for (int i = 0; i < count; i++)
+        generateChunkTerrain(tasks[i].chunk, tasks[i].cx, tasks[i].cy, tasks[i].cz);
+    double terrainTime = getWallTime() - start;
+
+    start = getWallTime();
+    long long changed = 0;
+    for (int i = 0; i < count; i++)
+        changed += placeChunkFeatures(tasks[i].chunk, tasks[i].cx, tasks[i].cy, tasks[i].cz);
+    double featureTime = getWallTime() - start;
+    uint64_t reference = hashTaskChunks(tasks, count);
+    printf("  terrain only     %9.0f chunks/s\n", count / terrainTime);
+    printf("  features pass    %9.0f chunks/s  %lld blocks placed, %.1f%% of generation time\n", count / featureTime,
+        changed, 100.0 * featureTime / (terrainTime + featureTime));
+
+    //Reversed order across every core has to build the same world
+    for (int i = 0; i < count; i++)
+        resetChunk(tasks[i].chunk);
+    ChunkGenTask *reversed = malloc(count * sizeof(ChunkGenTask));
+    for (int i = 0; i < count; i++)
+        reversed[i] = tasks[count - 1 - i];
+    //At least a few threads even on small machines so the interleaving differs from the serial pass
+    int threads = (getCpuCount() < 4) ? 4 : getCpuCount();
+    ThreadPool *pool = createThreadPool(threads - 1);
+    setTerrainGenerator(generator, seed);
+    start = getWallTime();
+    generateChunks(pool, reversed, count);
+    double parallelTime = getWallTime() - start;
+    destroyThreadPool(pool);
+    printf("  reversed, %2d threads %9.0f chunks/s  %s\n", threads, count / parallelTime,
+        hashTaskChunks(tasks, count) == reference ? "identical" : "MISMATCH");
+
+    for (int i = 0; i < count; i++)
+        resetChunk(tasks[i].chunk);
+    free(reversed);
+    free(tasks);
+    free(benchChunks);
+}
+
+typedef struct LodRing {
+    int chunks;
+    long long fullTriangles, lodTriangles;
+    double fullTime, lodTime;
+} LodRing;
+
+//Level changes while the player steps back and forth over the chunk border next to a ring edge
+static int countLodSwitches(int ringEdge, bool hysteresis)
+{
+    int lod = chooseChunkLod(ringEdge, -1);
+    int switches = 0;
+    for (int step = 0; step < 40; step++)
+    {
+        int distance = ringEdge + (step & 1);
+        int next = hysteresis ? chooseChunkLod(distance, lod) : chooseChunkLod(distance, -1);
+        if (next != lod) switches++;
+        lod = next;
+    }
+    return switches;
+}
+
+void runLodBench(void)
+{
+    initChunks();
+    int side = 2 * LOD_BENCH_RADIUS + 1;
+    printf("LOD benchmark: %d x %d columns, full meshes out to %d chunks, %d levels\n", side, side, LOD_RADIUS, LOD_LEVELS);
+
+    //Every chunk is meshed at full resolution and at the level its ring would get, same snapshot for both
+    LodRing rings[LOD_LEVELS] = {0};
+    ChunkSnapshot *snapshot = malloc(sizeof(ChunkSnapshot));
+    for (int dx = -LOD_BENCH_RADIUS; dx <= LOD_BENCH_RADIUS; dx++)
+    {
+        for (int dz = -LOD_BENCH_RADIUS; dz <= LOD_BENCH_RADIUS; dz++)
+        {
+            int distance = (abs(dx) > abs(dz)) ? abs(dx) : abs(dz);
+            int lod = chooseChunkLod(distance, -1);
+            LodRing *ring = &rings[lod];
+            for (int cy = 0; cy < WORLD_HEIGHT_CHUNKS; cy++)
+            {
+                uint16_t visibility;
+                if (chunkHasNoFaces(getChunk(SPAWN_CHUNK + dx, cy, SPAWN_CHUNK + dz), &visibility)) continue;
+                snapshotChunk(snapshot, SPAWN_CHUNK + dx, cy, SPAWN_CHUNK + dz);
+                ring->chunks++;
+
+                double start = getWallTime();
+                PackedMesh full = generatePackedChunkMesh(snapshot);
+                ring->fullTime += getWallTime() - start;
+                start = getWallTime();
+                PackedMesh reduced = generatePackedLodMesh(snapshot, lod);
+                ring->lodTime += getWallTime() - start;
+
+                ring->fullTriangles += full.vertexCount / 3;
+                ring->lodTriangles += reduced.vertexCount / 3;
+                MemFree(full.vertices);
+                MemFree(reduced.vertices);
+            }
+        }
+    }
+
+    LodRing total = {0};
+    for (int lod = 0; lod < LOD_LEVELS; lod++)
+    {
+        LodRing *ring = &rings[lod];
+        if (ring->chunks == 0) continue;
+        printf("  ring %dx %5d chunks  full %9lld tris %7.1f ms  reduced %9lld tris %7.1f ms  (%.1f%% of the triangles)\n",
+            1 << lod, ring->chunks, ring->fullTriangles, ring->fullTime * 1000.0, ring->lodTriangles, ring->lodTime * 1000.0,
+            100.0 * ring->lodTriangles / (ring->fullTriangles ? ring->fullTriangles : 1));
+        total.chunks += ring->chunks;
+        total.fullTriangles += ring->fullTriangles;
+        total.lodTriangles += ring->lodTriangles;
+        total.fullTime += ring->fullTime;
+        total.lodTime += ring->lodTime;
+    }
+    printf("  all     %5d chunks  full %9lld tris %7.1f ms  reduced %9lld tris %7.1f ms  (%.1f%% of the triangles)\n",
+        total.chunks, total.fullTriangles, total.fullTime * 1000.0, total.lodTriangles, total.lodTime * 1000.0,
+        100.0 * total.lodTriangles / (total.fullTriangles ? total.fullTriangles : 1));
+    printf("  stepping over the first ring edge 40 times: %d rebuilds with hysteresis, %d without\n",
+        countLodSwitches(LOD_RADIUS, true), countLodSwitches(LOD_RADIUS, false));
+
+    free(snapshot);
+    freeChunks();
+}
+
+//One layer's worth of chunks drawn either one buffer each or through the draw batches. Returns ms per frame,
+//the CPU part of it (walk and submit, before the swap) and the draw calls of the last frame
+static double timeBatchDraws(Camera3D camera, Shader shader, PackedMesh *meshes, bool batched, double *submitMs, int *drawCalls)
+{
+    double submit = 0.0;
+    double start = getWallTime();
+    for (int frame = 0; frame < DRAW_BENCH_FRAMES; frame++)
+    {
+        BeginDrawing();
+            ClearBackground(SKY_COLOR);
+            BeginMode3D(camera);
+                double submitStart = getWallTime();
+                beginPackedDraw(shader, GRAY);
+                *drawCalls = 0;
+                for (int cx = 0; cx < BATCH_BENCH_SIDE; cx++)
+                {
+                    for (int cz = 0; cz < BATCH_BENCH_SIDE; cz++)
+                    {
+                        for (int cy = 0; cy < WORLD_HEIGHT_CHUNKS; cy++)
+                        {
+                            PackedMesh *mesh = &meshes[(cx * BATCH_BENCH_SIDE + cz) * WORLD_HEIGHT_CHUNKS + cy];
+                            if (mesh->vertexCount == 0) continue;
+                            if (batched)
+                                queueBatchedDraw(cx, cy, cz);
+                            else
+                            {
+                                drawPackedMesh(mesh, (Vector3){cx * CHUNK_WIDTH, cy * CHUNK_HEIGHT, cz * CHUNK_WIDTH});
+                                (*drawCalls)++;
+                            }
+                        }
+                    }
+                }
+                if (batched)
+                {
+                    drawQueuedBatches();
+                    *drawCalls = getDrawBatchStats().drawCalls;
+                }
+                endPackedDraw();
+                submit += getWallTime() - submitStart;
+            EndMode3D();
+        EndDrawing();
+    }
+    *submitMs = submit * 1000.0 / DRAW_BENCH_FRAMES;
+    return (getWallTime() - start) * 1000.0 / DRAW_BENCH_FRAMES;
+}
+
+void runBatchBench(void)
+{
+    //Needs a GL context like --draw-bench
+    InitWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Batch benchmark");
+    SetTargetFPS(0);
+    initChunks();
+
+    Shader shader = loadFogShader("shader/chunk.vs", FOG_QUALITY);
+    float fogDensity = FOG_VALUE;
+    SetShaderValue(shader, GetShaderLocation(shader, "fogDensity"), &fogDensity, SHADER_UNIFORM_FLOAT);
+
+    float extent = BATCH_BENCH_SIDE * CHUNK_WIDTH;
+    Camera3D camera = {0};
+    camera.position = (Vector3){ -8.0f, WORLD_HEIGHT * 0.5f, -8.0f };
+    camera.target = (Vector3){ extent * 0.5f, WORLD_HEIGHT / 3.0f, extent * 0.5f };
+    camera.up = (Vector3){ 0.0f, 1.0f, 0.0f };
+    camera.fovy = CAMERA_FOV;
+    camera.projection = CAMERA_PERSPECTIVE;
+    SetShaderValue(shader, shader.locs[SHADER_LOC_VECTOR_VIEW], &camera.position.x, SHADER_UNIFORM_VEC3);
+
+    //Terrain meshes, each kept on the CPU for the batches and uploaded once more on its own
+    int chunkCount = BATCH_BENCH_SIDE * BATCH_BENCH_SIDE * WORLD_HEIGHT_CHUNKS;
+    PackedMesh *meshes = calloc(chunkCount, sizeof(PackedMesh));
+    uint8_t **copies = calloc(chunkCount, sizeof(uint8_t *));
+    ChunkSnapshot *snapshot = malloc(sizeof(ChunkSnapshot));
+    int meshed = 0;
+    for (int cx = 0; cx < BATCH_BENCH_SIDE; cx++)
+    {
+        for (int cz = 0; cz < BATCH_BENCH_SIDE; cz++)
+        {
+            for (int cy = 0; cy < WORLD_HEIGHT_CHUNKS; cy++)
+            {
+                int index = (cx * BATCH_BENCH_SIDE + cz) * WORLD_HEIGHT_CHUNKS + cy;
+                uint16_t visibility;
+                if (chunkHasNoFaces(getChunk(SPAWN_CHUNK + cx, cy, SPAWN_CHUNK + cz), &visibility)) continue;
+                snapshotChunk(snapshot, SPAWN_CHUNK + cx, cy, SPAWN_CHUNK + cz);
+                meshes[index] = generatePackedChunkMesh(snapshot);
+                if (meshes[index].vertexCount == 0) continue;
+                size_t bytes = packedMeshBytes(&meshes[index]);
+                copies[index] = malloc(bytes);
+                memcpy(copies[index], meshes[index].vertices, bytes);
+                storeBatchedMesh(cx, cy, cz, copies[index], meshes[index].vertexCount);
+                uploadPackedMesh(&meshes[index]);
+                meshed++;
+            }
+        }
+    }
+    free(snapshot);
+
+    DrawBatchStats batchStats = getDrawBatchStats();
+    printf("Batch benchmark: %d meshes in %d batches of %d x %d columns, %.1f of %.1f MB used, %d frames per case\n",
+        meshed, batchStats.batches, BATCH_SIZE, BATCH_SIZE, batchStats.usedBytes / (1024.0 * 1024.0), batchStats.bufferBytes / (1024.0 * 1024.0), DRAW_BENCH_FRAMES);
+    for (int batched = 0; batched < 2; batched++)
+    {
+        double submitMs;
+        int drawCalls;
+        double frameMs = timeBatchDraws(camera, shader, meshes, batched, &submitMs, &drawCalls);
+        printf("  %-9s %6.2f ms/frame, %6.2f ms CPU submit, %5d draw calls\n", batched ? "batched" : "per chunk", frameMs, submitMs, drawCalls);
+    }
+
+    //Edits store a mesh of about the same size over the old one, which stays in its range
+    double start = getWallTime();
+    long long patchesBefore = getDrawBatchStats().patches;
+    int patched = 0;
+    for (int i = 0; patched < BATCH_BENCH_PATCHES && meshed > 0; i++)
+    {
+        int index = i % chunkCount;
+        if (copies[index] == NULL) continue;
+        int cx = index / WORLD_HEIGHT_CHUNKS / BATCH_BENCH_SIDE;
+        int cz = index / WORLD_HEIGHT_CHUNKS % BATCH_BENCH_SIDE;
+        storeBatchedMesh(cx, index % WORLD_HEIGHT_CHUNKS, cz, copies[index], meshes[index].vertexCount);
+        patched++;
+    }
+    double patchUs = (getWallTime() - start) * 1e6 / (patched ? patched : 1);
+    batchStats = getDrawBatchStats();
+    printf("  %d stores over old meshes: %.1f us each, %lld patched in place, %lld buffer grows overall\n",
+        patched, patchUs, batchStats.patches - patchesBefore, batchStats.grows);
+
+    for (int i = 0; i < chunkCount; i++)
+    {
+        unloadPackedMesh(&meshes[i]);
+        free(copies[i]);
+    }
+    free(meshes);
+    free(copies);
+    freeDrawBatches();
+    UnloadShader(shader);
+    freeChunks();
+    CloseWindow();
+}
+
+//Frame time of a made up machine: a fixed part plus a cost per column, a quarter of it past the LOD radius
+static float simulatedFrameMs(float columnMs, uint32_t *seed)
+{
+    int side = 2 * currentRenderDistance + 1;
+    int fullSide = 2 * (currentLodRadius < currentRenderDistance ? currentLodRadius : currentRenderDistance) + 1;
+    float columns = fullSide * fullSide + 0.25f * (side * side - fullSide * fullSide);
+    return (1.0f + columnMs * columns) * randomRange(seed, 0.9f, 1.1f);
+}
+
+void runDistanceBench(void)
+{
+    //Drives the controller with a cost model instead of real frames, so it runs headless and the same every time
+    printf("Distance benchmark: %.2f ms budget, %d frame windows, distance %d..%d\n",
+        FRAME_BUDGET_MS, RENDER_DISTANCE_WINDOW, RENDER_DISTANCE_MIN, RENDER_DISTANCE_MAX);
+
+    //Machines from fast to very slow under a constant load, each started once from the defaults and once from the
+    //smallest distance and LOD radius. The middle ones balance near RENDER_DISTANCE_MIN, where one step costs the
+    //most. Columns that join the square become backlog that drains over frames
+    const float columnMs[] = { 0.004f, 0.03f, 0.06f, 0.09f, 0.12f, 0.25f };
+    const int machines = sizeof(columnMs) / sizeof(columnMs[0]);
+    uint32_t seed = 7;
+    bool allSettled = true;
+    for (int run = 0; run < 2 * machines; run++)
+    {
+        int machine = run / 2;
+        bool fromMinimum = run % 2;
+        initRenderDistance();
+        if (fromMinimum)
+        {
+            currentRenderDistance = RENDER_DISTANCE_MIN;
+            currentLodRadius = LOD_RADIUS_MIN;
+        }
+        int backlog = 0;
+        double frameSum = 0.0;
+        int overBudget = 0;
+        RenderDistanceStats half = {0};
+        for (int frame = 0; frame < DISTANCE_BENCH_FRAMES; frame++)
+        {
+            if (frame == DISTANCE_BENCH_FRAMES / 2) half = getRenderDistanceStats();
+            float frameMs = simulatedFrameMs(columnMs[machine], &seed);
+            if (frame >= DISTANCE_BENCH_FRAMES / 2)
+            {
+                frameSum += frameMs;
+                if (frameMs > FRAME_BUDGET_MS) overBudget++;
+            }
+            int oldSide = 2 * currentRenderDistance + 1;
+            if (updateRenderDistance(frameMs / 1000.0f, backlog))
+            {
+                int side = 2 * currentRenderDistance + 1;
+                if (side > oldSide) backlog += (side * side - oldSide * oldSide) * WORLD_HEIGHT_CHUNKS;
+            }
+            backlog -= CHUNK_LOADS_PER_FRAME;
+            if (backlog < 0) backlog = 0;
+        }
+        //Under a constant load the distance should walk one way to where it fits and stay there
+        RenderDistanceStats after = getRenderDistanceStats();
+        bool settled = after.reversals == 0 && after.changes == half.changes;
+        allSettled = allSettled && settled;
+        printf("  %.3f ms/column from %-8s %s at distance %d, LOD radius %d, %.2f ms/frame, %.1f%% over budget, %d steps, %d reversals\n",
+            columnMs[machine], fromMinimum ? "minimum:" : "default:", settled ? "settled" : "NOT SETTLED", after.renderDistance, after.lodRadius,
+            frameSum / (DISTANCE_BENCH_FRAMES / 2), 100.0 * overBudget / (DISTANCE_BENCH_FRAMES / 2), after.changes, after.reversals);
+    }
+    printf("  %s\n", allSettled ? "every machine settled without reversing" : "SOME MACHINES DID NOT SETTLE");
+    initRenderDistance();
+}
+
+//The per voxel DDA raycastVoxel used before castVoxelRay, one getBlockAtWorld per step. The reference for --ray-bench
+static bool referenceVoxelRay(Vector3 origin, Vector3 dir, float maxDistance, VoxelHit *hit)
+{
+    int x = (int)floor(origin.x);
+    int y = (int)floor(origin.y);
+    int z = (int)floor(origin.z);
+    *hit = (VoxelHit){ false, x, y, z, FACE_NONE, 0.0f };
+    if (getBlockAtWorld(x, y, z))
+    {
+        hit->hit = true;
+        return true;
+    }
+
+    int stepX = (dir.x > 0.f) ? 1 : -1;
+    int stepY = (dir.y > 0.f) ? 1 : -1;
+    int stepZ = (dir.z > 0.f) ? 1 : -1;
+    float tDeltaX = (dir.x == 0.f) ? INFINITY : fabs(1.f / dir.x);
+    float tDeltaY = (dir.y == 0.f) ? INFINITY : fabs(1.f / dir.y);
+    float tDeltaZ = (dir.z == 0.f) ? INFINITY : fabs(1.f / dir.z);
+    float rx = origin.x, ry = origin.y, rz = origin.z;
+    float tMaxX = (dir.x > 0.f) ? ((x + 1.0f) - rx) * tDeltaX : (rx - (float)x) * tDeltaX;
+    float tMaxY = (dir.y > 0.f) ? ((y + 1.0f) - ry) * tDeltaY : (ry - (float)y) * tDeltaY;
+    float tMaxZ = (dir.z > 0.f) ? ((z + 1.0f) - rz) * tDeltaZ : (rz - (float)z) * tDeltaZ;
+
+    float t = 0.0f;
+    while (t <= maxDistance)
+    {
+        BlockFace face;
+        if (tMaxX < tMaxY)
+        {
+            if (tMaxX < tMaxZ) { x += stepX; t = tMaxX; tMaxX += tDeltaX; face = (stepX > 0) ? FACE_NEG_X : FACE_POS_X; }
+            else { z += stepZ; t = tMaxZ; tMaxZ += tDeltaZ; face = (stepZ > 0) ? FACE_NEG_Z : FACE_POS_Z; }
+        }
+        else
+        {
+            if (tMaxY < tMaxZ) { y += stepY; t = tMaxY; tMaxY += tDeltaY; face = (stepY > 0) ? FACE_NEG_Y : FACE_POS_Y; }
+            else { z += stepZ; t = tMaxZ; tMaxZ += tDeltaZ; face = (stepZ > 0) ? FACE_NEG_Z : FACE_POS_Z; }
+        }
+        if (getBlockAtWorld(x, y, z))
+        {
+            *hit = (VoxelHit){ true, x, y, z, face, t };
+            return true;
+        }
+    }
+    return false;
+}
+
+static Vector3 randomDirection(uint32_t *seed)
+{
+    for (;;)
+    {
+        Vector3 d = { randomRange(seed, -1.0f, 1.0f), randomRange(seed, -1.0f, 1.0f), randomRange(seed, -1.0f, 1.0f) };
+        float length = sqrtf(d.x * d.x + d.y * d.y + d.z * d.z);
+        if (length > 0.1f && length <= 1.0f) return (Vector3){ d.x / length, d.y / length, d.z / length };
+    }
+}
+
+typedef enum RaySet {
+    RAYS_REACH,     //Block picking from just above the ground
+    RAYS_LONG,      //Line of sight across the area, anywhere in the world's height
+    RAYS_SUN,       //From the surface toward a fixed sun
+    RAYS_GRID,      //Whole and half block origins along axes and diagonals, every crossing a tie
+    RAY_SET_COUNT
+} RaySet;
+
+static const char *raySetNames[RAY_SET_COUNT] = { "reach", "long", "sun", "grid" };
+
+static void fillRaySet(VoxelRay *rays, RaySet set, uint32_t *seed)
+{
+    const float spread = 48.0f; //Blocks around the centre the origins come from
+    float centre = SPAWN_CHUNK * CHUNK_WIDTH + 0.5f * CHUNK_WIDTH;
+    for (int i = 0; i < RAY_BENCH_RAYS; i++)
+    {
+        Vector3 origin = { centre + randomRange(seed, -spread, spread), 0.0f, centre + randomRange(seed, -spread, spread) };
+        int wx = (int)origin.x, wz = (int)origin.z; //Spawn is far from the origin, never negative
+        ColumnHeights column;
+        getColumnHeights(wx / CHUNK_WIDTH, wz / CHUNK_WIDTH, &column);
+        float surface = column.heights[wx % CHUNK_WIDTH][wz % CHUNK_WIDTH] + 1.0f;
+
+        VoxelRay *ray = &rays[i];
+        switch (set)
+        {
+            case RAYS_REACH:
+                origin.y = surface + randomRange(seed, 1.0f, 3.0f);
+                *ray = (VoxelRay){ origin, randomDirection(seed), MAX_REACH };
+                break;
+            case RAYS_LONG:
+                origin.y = randomRange(seed, 0.0f, WORLD_HEIGHT + 16.0f);
+                *ray = (VoxelRay){ origin, randomDirection(seed), 160.0f };
+                break;
+            case RAYS_SUN:
+                origin.y = surface + 0.5f;
+                *ray = (VoxelRay){ origin, (Vector3){ 0.3f, 0.906f, 0.3f }, 320.0f };
+                break;
+            default:
+            {
+                origin = (Vector3){ floorf(origin.x) + 0.5f * (i & 1), floorf(surface + randomRange(seed, -8.0f, 8.0f)), floorf(origin.z) + 0.5f * (i & 2) / 2 };
+                Vector3 dir = { (float)((int)randomRange(seed, 0.0f, 3.0f) - 1), (float)((int)randomRange(seed, 0.0f, 3.0f) - 1), (float)((int)randomRange(seed, 0.0f, 3.0f) - 1) };
+                *ray = (VoxelRay){ origin, dir, 100.0f };
+                break;
+            }
+        }
+    }
+}
+
+static int compareRaySet(const VoxelRay *rays, VoxelHit *fast, VoxelHit *reference, double *fastSeconds, double *referenceSeconds)
+{
+    double start = getWallTime();
+    for (int i = 0; i < RAY_BENCH_RAYS; i++)
+        referenceVoxelRay(rays[i].origin, rays[i].direction, rays[i].maxDistance, &reference[i]);
+    *referenceSeconds = getWallTime() - start;
+
+    start = getWallTime();
+    castVoxelRays(rays, RAY_BENCH_RAYS, fast);
+    *fastSeconds = getWallTime() - start;
+
+    //An axis-parallel ray from a block boundary gets a NaN distance from the plain DDA too, those count as equal
+    int mismatches = 0;
+    for (int i = 0; i < RAY_BENCH_RAYS; i++)
+    {
+        const VoxelHit *a = &fast[i], *b = &reference[i];
+        if (a->hit != b->hit) mismatches++;
+        else if (a->hit && (a->x != b->x || a->y != b->y || a->z != b->z || a->face != b->face
+            || (a->distance != b->distance && !(isnan(a->distance) && isnan(b->distance))))) mismatches++;
+    }
+    return mismatches;
+}
+
+void runRayBench(void)
+{
+    //Everything a ray can reach is resident up front, so neither side generates chunks while timed
+    initChunks();
+    for (int dx = -RAY_BENCH_RADIUS; dx <= RAY_BENCH_RADIUS; dx++)
+        for (int dz = -RAY_BENCH_RADIUS; dz <= RAY_BENCH_RADIUS; dz++)
+            for (int cy = 0; cy < WORLD_HEIGHT_CHUNKS; cy++)
+                getChunk(SPAWN_CHUNK + dx, cy, SPAWN_CHUNK + dz);
+    //Summaries are built once per chunk and after edits, not per ray
+    double start = getWallTime();
+    for (int dx = -RAY_BENCH_RADIUS; dx <= RAY_BENCH_RADIUS; dx++)
+        for (int dz = -RAY_BENCH_RADIUS; dz <= RAY_BENCH_RADIUS; dz++)
+            for (int cy = 0; cy < WORLD_HEIGHT_CHUNKS; cy++)
+                getChunkBricks(getChunk(SPAWN_CHUNK + dx, cy, SPAWN_CHUNK + dz));
+    printf("Ray benchmark: %d rays per set, %d x %d columns resident, brick summaries %.2f ms\n", RAY_BENCH_RAYS,
+        2 * RAY_BENCH_RADIUS + 1, 2 * RAY_BENCH_RADIUS + 1, (getWallTime() - start) * 1000.0);
+
+    VoxelRay *rays = malloc(RAY_BENCH_RAYS * sizeof(VoxelRay));
+    VoxelHit *fast = malloc(RAY_BENCH_RAYS * sizeof(VoxelHit));
+    VoxelHit *reference = malloc(RAY_BENCH_RAYS * sizeof(VoxelHit));
+    uint32_t seed = 99;
+    for (int pass = 0; pass < 2; pass++)
+    {
+        //Second pass after carving caves and stacking slabs, so the brick summaries have to catch up with edits
+        if (pass == 1)
+        {
+            int centre = SPAWN_CHUNK * CHUNK_WIDTH + CHUNK_WIDTH / 2;
+            for (int i = 0; i < 24; i++)
+            {
+                int x = centre + (int)randomRange(&seed, -64.0f, 64.0f), z = centre + (int)randomRange(&seed, -64.0f, 64.0f);
+                int y = (int)randomRange(&seed, 10.0f, WORLD_HEIGHT / 2.0f);
+                if (i & 1) carveSphere(x, y, z, 6);
+                else fillRegion(x, y + 20, z, x + 12, y + 21, z + 12, SOLID);
+            }
+            printf("  after 24 edits:\n");
+        }
+        for (int set = 0; set < RAY_SET_COUNT; set++)
+        {
+            fillRaySet(rays, set, &seed);
+            double fastSeconds, referenceSeconds;
+            int mismatches = compareRaySet(rays, fast, reference, &fastSeconds, &referenceSeconds);
+            int hits = 0;
+            for (int i = 0; i < RAY_BENCH_RAYS; i++) hits += fast[i].hit;
+            printf("  %-6s %5.1f%% hit  per voxel %6.2f M rays/s  bricks %6.2f M rays/s  (%.1fx)  %d mismatches\n",
+                raySetNames[set], 100.0 * hits / RAY_BENCH_RAYS, RAY_BENCH_RAYS / referenceSeconds / 1e6, RAY_BENCH_RAYS / fastSeconds / 1e6,
+                referenceSeconds / fastSeconds, mismatches);
+        }
+    }
+    free(rays);
+    free(fast);
+    free(reference);
+    freeChunks();
+}
+
+//Whether the box reaches more than a hair into any solid block
+static bool bodyInBlock(const PhysicsBody *body)
+{
+    const float hair = 0.01f;
+    int x0 = (int)floorf(body->position.x - body->size.x * 0.5f + hair), x1 = (int)floorf(body->position.x + body->size.x * 0.5f - hair);
+    int y0 = (int)floorf(body->position.y - body->size.y * 0.5f + hair), y1 = (int)floorf(body->position.y + body->size.y * 0.5f - hair);
+    int z0 = (int)floorf(body->position.z - body->size.z * 0.5f + hair), z1 = (int)floorf(body->position.z + body->size.z * 0.5f - hair);
+    for (int y = y0; y <= y1; y++)
+        for (int z = z0; z <= z1; z++)
+            for (int x = x0; x <= x1; x++)
+                if (getBlockAtWorld(x, y, z) != AIR) return true;
+    return false;
+}
+
+//Players and bigger mobs dropped a little above the ground anywhere within 40 blocks of the spawn
+static void placeBenchBodies(PhysicsBody *bodies, uint32_t seed)
+{
+    float centre = SPAWN_CHUNK * CHUNK_WIDTH + 0.5f * CHUNK_WIDTH;
+    for (int i = 0; i < PHYSICS_BENCH_BODIES; i++)
+    {
+        Vector3 size = (i % 4 == 3) ? (Vector3){ 1.8f, 1.8f, 1.8f } : (Vector3){ PLAYER_WIDTH, PLAYER_HEIGHT, PLAYER_WIDTH };
+        Vector3 position = { centre + randomRange(&seed, -40.0f, 40.0f), 0.0f, centre + randomRange(&seed, -40.0f, 40.0f) };
+        int wx = (int)position.x, wz = (int)position.z;
+        ColumnHeights column;
+        getColumnHeights(wx / CHUNK_WIDTH, wz / CHUNK_WIDTH, &column);
+        position.y = column.heights[wx % CHUNK_WIDTH][wz % CHUNK_WIDTH] + 1.0f + size.y * 0.5f + randomRange(&seed, 0.0f, 3.0f);
+        bodies[i] = makeBody(position, size);
+        //Trees stand on some of the spots
+        while (bodyInBlock(&bodies[i])) bodies[i].position.y += 1.0f;
+    }
+}
+
+//Each body walks one way for a while, stands still now and then and jumps at random. Written without looking at the
+//bodies, so the same tape can be played back against any start
+static void recordInputTape(BodyInput *tape, uint32_t seed)
+{
+    for (int i = 0; i < PHYSICS_BENCH_BODIES; i++)
+    {
+        BodyInput held = {0};
+        int holdSteps = 0;
+        for (int step = 0; step < PHYSICS_BENCH_STEPS; step++)
+        {
+            if (holdSteps-- <= 0)
+            {
+                float angle = randomRange(&seed, 0.0f, 2.0f * PI);
+                float speed = (randomRange(&seed, 0.0f, 1.0f) < 0.2f) ? 0.0f : MOVEMENT_SPEED;
+                held = (BodyInput){ cosf(angle) * speed, sinf(angle) * speed, 0.0f };
+                holdSteps = (int)randomRange(&seed, 60.0f, 240.0f);
+            }
+            BodyInput input = held;
+            if (randomRange(&seed, 0.0f, 1.0f) < 1.0f / 600.0f) input.jump = JUMP_FORCE;
+            tape[step * PHYSICS_BENCH_BODIES + i] = input;
+        }
+    }
+}
+
+static uint64_t hashBodies(uint64_t hash, const PhysicsBody *bodies)
+{
+    for (int i = 0; i < PHYSICS_BENCH_BODIES; i++)
+    {
+        hash = hashBytes(hash, &bodies[i].position, sizeof(Vector3));
+        hash = hashBytes(hash, &bodies[i].velocity, sizeof(Vector3));
+        hash = hashBytes(hash, &bodies[i].onGround, sizeof(bool));
+    }
+    return hash;
+}
+
+//Plays the tape from the start. oneAtATime steps each body with its own call, last body first, which must not
+//change anything since bodies only see the blocks. trace gets the state hash after every step when not NULL
+static uint64_t replayTape(PhysicsBody *bodies, const BodyInput *tape, bool oneAtATime, uint64_t *trace)
+{
+    placeBenchBodies(bodies, 4242);
+    for (int step = 0; step < PHYSICS_BENCH_STEPS; step++)
+    {
+        const BodyInput *inputs = &tape[step * PHYSICS_BENCH_BODIES];
+        if (oneAtATime)
+            for (int i = PHYSICS_BENCH_BODIES - 1; i >= 0; i--) stepBodies(&bodies[i], &inputs[i], 1);
+        else
+            stepBodies(bodies, inputs, PHYSICS_BENCH_BODIES);
+        if (trace) trace[step] = hashBodies(1469598103934665603ULL, bodies);
+    }
+    return hashBodies(1469598103934665603ULL, bodies);
+}
+
+void runPhysicsBench(void)
+{
+    initChunks();
+    for (int dx = -PHYSICS_BENCH_RADIUS; dx <= PHYSICS_BENCH_RADIUS; dx++)
+        for (int dz = -PHYSICS_BENCH_RADIUS; dz <= PHYSICS_BENCH_RADIUS; dz++)
+            for (int cy = 0; cy < WORLD_HEIGHT_CHUNKS; cy++)
+                getChunkBricks(getChunk(SPAWN_CHUNK + dx, cy, SPAWN_CHUNK + dz));
+
+    PhysicsBody *bodies = malloc(PHYSICS_BENCH_BODIES * sizeof(PhysicsBody));
+    PhysicsBody *start = malloc(PHYSICS_BENCH_BODIES * sizeof(PhysicsBody));
+    BodyInput *tape = malloc((size_t)PHYSICS_BENCH_STEPS * PHYSICS_BENCH_BODIES * sizeof(BodyInput));
+    uint64_t *trace = malloc(PHYSICS_BENCH_STEPS * sizeof(uint64_t));
+    uint64_t *traceAgain = malloc(PHYSICS_BENCH_STEPS * sizeof(uint64_t));
+    recordInputTape(tape, 77);
+    placeBenchBodies(start, 4242);
+    printf("Physics benchmark: %d bodies, %d steps of %.2f ms recorded\n", PHYSICS_BENCH_BODIES, PHYSICS_BENCH_STEPS, PHYSICS_STEP * 1000.0f);
+
+    double startTime = getWallTime();
+    uint64_t timedHash = replayTape(bodies, tape, false, NULL);
+    double seconds = getWallTime() - startTime;
+    printf("  %.2f M body steps/s (%.3f us per body step)\n", (double)PHYSICS_BENCH_BODIES * PHYSICS_BENCH_STEPS / seconds / 1e6,
+        seconds * 1e6 / ((double)PHYSICS_BENCH_BODIES * PHYSICS_BENCH_STEPS));
+
+    int inBlock = 0, grounded = 0;
+    double travelled = 0.0;
+    for (int i = 0; i < PHYSICS_BENCH_BODIES; i++)
+    {
+        inBlock += bodyInBlock(&bodies[i]);
+        grounded += bodies[i].onGround;
+        float dx = bodies[i].position.x - start[i].position.x, dz = bodies[i].position.z - start[i].position.z;
+        travelled += sqrtf(dx * dx + dz * dz);
+    }
+    printf("  end: %d on the ground, %d inside a block, %.1f blocks from the start on average\n", grounded, inBlock,
+        travelled / PHYSICS_BENCH_BODIES);
+
+    //Determinism, the tape played twice more: batched and body by body in reverse, stepwise states compared
+    uint64_t batchedHash = replayTape(bodies, tape, false, trace);
+    uint64_t singleHash = replayTape(bodies, tape, true, traceAgain);
+    int firstDiverged = -1;
+    for (int step = 0; step < PHYSICS_BENCH_STEPS && firstDiverged < 0; step++)
+        if (trace[step] != traceAgain[step]) firstDiverged = step;
+    bool same = timedHash == batchedHash && batchedHash == singleHash && firstDiverged < 0;
+    printf("  replay: %016llx %016llx %016llx, %s", (unsigned long long)timedHash, (unsigned long long)batchedHash,
+        (unsigned long long)singleHash, same ? "identical\n" : "DIFFERENT");
+    if (!same) printf(", first step apart %d\n", firstDiverged);
+
+    free(bodies);
+    free(start);
+    free(tape);
+    free(trace);
+    free(traceAgain);
+    freeChunks();
+}
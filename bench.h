@@ -0,0 +1,29 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdbool.h>
+
+//Benchmarks selected from the command line (main.exe --gen-bench). Returns false for an unknown name.
+//All are headless except --draw-bench and --batch-bench, which need a window for the GL context
+bool runBenchmark(const char *name);
+
+void runGenBench(void);
+void runMeshBench(void);
+void runDrawBench(void);
+void runFrustumBench(void);
+void runCullBench(void);
+void runRingBench(void);
+void runMapBench(void);
+void runHeightBench(void);
+void runRegionBench(void);
+void runMeshCacheBench(void);
+void runEditBench(void);
+void runTerrainBench(void);
+void runFeatureBench(void);
+void runLodBench(void);
+void runBatchBench(void);
+void runDistanceBench(void);
+void runRayBench(void);
+void runPhysicsBench(void);
+
+#endif
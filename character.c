@@ -1,7 +1,7 @@
 #include "raylib.h"
 #include <stdbool.h>
 #include "character.h"
-#include "chunk.h"
+#include "config.h"
 #include <math.h>
 
 //Needed for linker
@@ -9,26 +9,10 @@ Player player;
 
 void spawnPlayer(Vector3 position)
 {
-    player.position = position;
-    player.velocity = (Vector3){0,0,0};
-    player.onGround = false; //TODO: This probably needs to getBlock under position at some point
-    player.size = (Vector2){1.0f, 1.0f};
-}
-
-static bool isSolidBlock(int x, int y, int z)
-{
-    return getBlockAtWorld(x,y,z) != AIR;
-}
-
-static bool checkGrounded(Player *player)
-{
-    float footYf = player->position.y - (player->size.y * 0.5f) - 0.05f;
-
-    int footX = (int)floorf(player->position.x);
-    int footY = (int)floorf(footYf);
-    int footZ = (int)floorf(player->position.z);
-
-    return isSolidBlock(footX, footY, footZ);
+    player.body = makeBody(position, (Vector3){ PLAYER_WIDTH, PLAYER_HEIGHT, PLAYER_WIDTH });
+    player.previousPosition = position;
+    player.stepTime = 0.0f;
+    player.jumpQueued = false;
 }
 
 void updatePlayer(float dt, Camera3D *camera)
@@ -67,68 +51,28 @@ void updatePlayer(float dt, Camera3D *camera)
         move.z = (move.z / mLen) * MOVEMENT_SPEED;
     }
 
-    player.velocity.x = move.x;
-    player.velocity.z = move.z;
-
-    if (!player.onGround)
-        player.velocity.y += GRAVITY * dt;
-    else if (player.velocity.y < 0.0f)
-        player.velocity.y = 0.0f;
-
-    if (player.onGround && IsKeyPressed(KEY_SPACE))
-    {
-        player.velocity.y = JUMP_FORCE;
-        player.onGround = false;
-    }
-
-    player.position.x += player.velocity.x * dt;
-    player.position.z += player.velocity.z * dt;
-
-
-    //TODO: Improve Collision It sucks
-    float nextY = player.position.y + player.velocity.y * dt;
-    float footYf = nextY - (player.size.y * 0.5f);
-
-    int minX = (int)floorf(player.position.x - player.size.x * 0.5f);
-    int maxX = (int)floorf(player.position.x + player.size.x * 0.5f);
-    int minZ = (int)floorf(player.position.z - player.size.x * 0.5f);
-    int maxZ = (int)floorf(player.position.z + player.size.x * 0.5f);
-    int footY = (int)floorf(footYf);
-
-    bool hitGround = false;
+    //A press between steps is kept for the next one
+    if (IsKeyPressed(KEY_SPACE)) player.jumpQueued = true;
 
-    for (int x = minX; x <= maxX; x++)
-    {
-        for (int z = minZ; z <= maxZ; z++)
-        {
-            if (isSolidBlock(x, footY, z))
-            {
-                hitGround = true;
-                break;
-            }
-        }
-        if (hitGround) break;
-    }
-
-    if (hitGround)
-    {
-        player.onGround = true;
-        player.velocity.y = 0.0f;
-        player.position.y = (float)footY + 1.0f + (player.size.y * 0.5f);
-    }
-    else
+    int steps = takePhysicsSteps(&player.stepTime, dt);
+    for (int i = 0; i < steps; i++)
     {
-        player.onGround = false;
-        player.position.y = nextY;
+        BodyInput input = { move.x, move.z, player.jumpQueued ? JUMP_FORCE : 0.0f };
+        player.jumpQueued = false;
+        player.previousPosition = player.body.position;
+        stepBodies(&player.body, &input, 1);
     }
 }
 
 void applyPlayerCamera(Camera3D *camera)
 {
+    //Steps are fixed and frames are not, so the camera follows where the body is part way into the next step
+    float alpha = player.stepTime / PHYSICS_STEP;
+    Vector3 from = player.previousPosition, to = player.body.position;
     Vector3 desiredPos = {
-        player.position.x,
-        player.position.y + CAMERA_HEIGHT,
-        player.position.z
+        from.x + (to.x - from.x) * alpha,
+        from.y + (to.y - from.y) * alpha + CAMERA_HEIGHT,
+        from.z + (to.z - from.z) * alpha
     };
 
     Vector3 delta = (Vector3){desiredPos.x - camera->position.x, desiredPos.y - camera->position.y, desiredPos.z - camera->position.z};
@@ -2,20 +2,22 @@
 #define CHARACTER_H
 
 #include "raylib.h"
+#include "physics.h"
 #include <stdbool.h>
 
-#define GRAVITY -10.0f
 #define MOVEMENT_SPEED 3.4f
 #define JUMP_FORCE 10.0f
 #define CAMERA_HEIGHT 0.5f
+#define PLAYER_WIDTH 0.8f //Fits through one block gaps
+#define PLAYER_HEIGHT 1.0f
 
 //TODO: Implement character and first person camera. Might wanna add the camera to the struct tbh. I think we can do collisions based on a rough block with 
 //Width and height instead of whatever character model I come up with. Probably would feel better anyway.
 typedef struct Player{
-    Vector3 position;
-    Vector3 velocity;
-    bool onGround;
-    Vector2 size; //width, height
+    PhysicsBody body;
+    Vector3 previousPosition; //Body position a step back, the camera is placed between the two
+    float stepTime;     //Frame time not simulated yet
+    bool jumpQueued;    //Space went down since the last step
 } Player;
 
 extern Player player;
@@ -2,134 +2,639 @@
 #include <stdlib.h>
 #include <math.h>
 #include <stdio.h>
+#include <string.h>
 #include "mesh.h"
+#include "meshjobs.h"
+#include "threadpool.h"
+#include "chunkmap.h"
+#include "visibility.h"
+#include "region.h"
+#include "terrain.h"
+#include "structures.h"
 
-Chunk ***chunks = NULL;
 int currentRenderDistance = DEFAULT_RENDER_DISTANCE;
+int currentLodRadius = LOD_RADIUS;
+static ChunkMap chunkMap = {0};
+static ThreadPool *genPool = NULL;
 
-void allocateChunks(int worldSize)
+//Chunk columns waiting to be loaded (meshed) or unloaded, worked off a few per frame in distance order
+typedef struct ChunkColumn {
+    int cx, cz;
+} ChunkColumn;
+
+typedef struct ColumnQueue {
+    ChunkColumn *items;
+    int head;
+    int count;
+    int capacity;
+} ColumnQueue;
+
+static ColumnQueue loadQueue = {0};
+static ColumnQueue unloadQueue = {0};
+//Square the resident set was last built for
+static bool haveResidentSquare = false;
+static int residentCx = 0, residentCz = 0, residentRadius = 0;
+//LOD radius the levels were last chosen with, -1 until the first full pass
+static int leveledLodRadius = -1;
+static long long lodColumnsChecked = 0;
+
+typedef struct DirtyChunk {
+    int cx, cy, cz;
+} DirtyChunk;
+
+//Chunks edited since the last flushDirtyChunks, each listed once
+static DirtyChunk *dirtyChunks = NULL;
+static int dirtyCount = 0;
+static int dirtyCapacity = 0;
+
+void initChunks(void)
+{
+    //Room for the render square and its border before the first grow
+    int side = 2 * (DEFAULT_RENDER_DISTANCE + 2) + 1;
+    initChunkMap(&chunkMap, side * side * WORLD_HEIGHT_CHUNKS * 2);
+}
+
+static void destroyChunk(Chunk *chunk)
+{
+    releaseChunkMesh(chunk);
+    for (int s = 0; s < CHUNK_SECTIONS; s++)
+        freeSection(&chunk->sections[s]);
+    free(chunk);
+}
+
+void freeChunks(void)
+{
+    int cursor = 0;
+    Chunk *chunk;
+    while ((chunk = chunkMapNext(&chunkMap, &cursor)) != NULL)
+        destroyChunk(chunk);
+    freeChunkMap(&chunkMap);
+    destroyThreadPool(genPool);
+    genPool = NULL;
+
+    //Nothing is resident any more
+    free(loadQueue.items);
+    free(unloadQueue.items);
+    loadQueue = (ColumnQueue){0};
+    unloadQueue = (ColumnQueue){0};
+    haveResidentSquare = false;
+    leveledLodRadius = -1;
+    free(dirtyChunks);
+    dirtyChunks = NULL;
+    dirtyCount = dirtyCapacity = 0;
+}
+
+static int floor_div(int a, int b)
 {
-    chunks = (struct Chunk ***)malloc(worldSize * sizeof(struct Chunk **));
-    for (int cx = 0; cx < worldSize; cx++)
+    int d = a / b;
+    if ((a ^ b) < 0 && (a % b)) d -= 1;
+    return d;
+}
+
+int getChunkBlock(const Chunk *chunk, int x, int y, int z)
+{
+    return getSectionBlock(&chunk->sections[y / SECTION_HEIGHT], x, y % SECTION_HEIGHT, z);
+}
+
+void setChunkBlock(Chunk *chunk, int x, int y, int z, int blockID)
+{
+    setSectionBlock(&chunk->sections[y / SECTION_HEIGHT], x, y % SECTION_HEIGHT, z, (uint8_t)blockID);
+    //A block going in can only fill its brick, one going out may have been the brick's last
+    if (blockID != AIR) chunk->bricks[y / SECTION_HEIGHT] |= 1ULL << BRICK_INDEX(x, y, z);
+    else chunk->bricksBuilt = false;
+}
+
+const uint64_t *getChunkBricks(Chunk *chunk)
+{
+    if (chunk->bricksBuilt) return chunk->bricks;
+
+    uint8_t raw[SECTION_VOLUME];
+    for (int s = 0; s < CHUNK_SECTIONS; s++)
     {
-        chunks[cx] = (struct Chunk **)malloc(1 * sizeof(struct Chunk *));
-        chunks[cx][0] = (struct Chunk *)malloc(worldSize * sizeof(struct Chunk));
+        const ChunkSection *section = &chunk->sections[s];
+        if (section->storage == SECTION_UNIFORM)
+        {
+            chunk->bricks[s] = (section->palette[0] != AIR) ? ~0ULL : 0;
+            continue;
+        }
+        unpackSection(section, raw);
+        uint64_t bricks = 0;
+        for (int y = 0; y < SECTION_HEIGHT; y++)
+            for (int z = 0; z < CHUNK_WIDTH; z++)
+                for (int x = 0; x < CHUNK_WIDTH; x++)
+                    if (raw[SECTION_INDEX(x, y, z)] != AIR) bricks |= 1ULL << BRICK_INDEX(x, y, z);
+        chunk->bricks[s] = bricks;
     }
+    chunk->bricksBuilt = true;
+    return chunk->bricks;
 }
 
-void freeChunks(int worldSize)
+void generateChunkTerrain(Chunk *chunk, int cx, int cy, int cz)
 {
-    if (chunks == NULL) return;
-    
-    for (int cx = 0; cx < worldSize; cx++)
+    //Surface height of every column in world blocks, shared with the other layers of the column
+    ColumnHeights column;
+    getColumnHeights(cx, cz, &column);
+
+    //Sections the surface does not pass through are all air or all solid and never allocate.
+    //The rest are written raw, one solid run and one air run per column, then packed so each picks its smallest storage once
+    uint8_t raw[SECTION_VOLUME];
+    for (int s = 0; s < CHUNK_SECTIONS; s++)
     {
-        for (int cy = 0; cy < 1; cy++)
+        int bottom = cy * CHUNK_HEIGHT + s * SECTION_HEIGHT;
+        int top = bottom + SECTION_HEIGHT - 1;
+        freeSection(&chunk->sections[s]);
+        if (bottom > column.highest)
+        {
+            initSection(&chunk->sections[s], AIR);
+            continue;
+        }
+        if (top <= column.lowest)
+        {
+            initSection(&chunk->sections[s], SOLID);
+            continue;
+        }
+        for(int x = 0; x < CHUNK_WIDTH; x++)
         {
-            for (int cz = 0; cz < worldSize; cz++)
+            for(int z = 0; z < CHUNK_WIDTH; z++)
             {
-                if(chunks[cx][cy][cz].model.meshCount > 0)
-                    UnloadModel(chunks[cx][cy][cz].model);
+                int solid = column.heights[x][z] - bottom + 1;
+                if (solid < 0) solid = 0;
+                if (solid > SECTION_HEIGHT) solid = SECTION_HEIGHT;
+                int y = 0;
+                for(; y < solid; y++)
+                    raw[SECTION_INDEX(x, y, z)] = SOLID;
+                for(; y < SECTION_HEIGHT; y++)
+                    raw[SECTION_INDEX(x, y, z)] = AIR;
             }
         }
-        free(chunks[cx][0]);
-        free(chunks[cx]);
+        packSection(&chunk->sections[s], raw);
     }
-    free(chunks);
-    chunks = NULL;
+    //Dont generate mesh yet, only want to when needed.
+    chunk->model = (Model){0};
+    chunk->generated = true;
 }
 
-static int floor_div(int a, int b)
+Chunk *findChunk(int cx, int cy, int cz)
 {
-    int d = a / b;
-    if ((a ^ b) < 0 && (a % b)) d -= 1;
-    return d;
+    if (cy < 0 || cy >= WORLD_HEIGHT_CHUNKS) return NULL;
+    return chunkMapGet(&chunkMap, packChunkKey(cx, cy, cz));
 }
 
-void initChunks()
+//Empty (not yet generated) chunk in the map, or the existing one
+static Chunk *createChunk(int cx, int cy, int cz)
 {
-    printf("START");
-    // Initialize all chunks
-    for(int cx = 0; cx < WORLD_SIZE_CHUNKS; cx++)
+    Chunk *chunk = findChunk(cx, cy, cz);
+    if (chunk != NULL) return chunk;
+
+    chunk = calloc(1, sizeof(Chunk));
+    chunk->cx = cx;
+    chunk->cy = cy;
+    chunk->cz = cz;
+    chunkMapInsert(&chunkMap, packChunkKey(cx, cy, cz), chunk);
+    return chunk;
+}
+
+//Saved chunks come back from their region file, everything else is generated
+static void fillChunk(Chunk *chunk, int cx, int cy, int cz)
+{
+    //Saved chunks already hold their features
+    if (!loadChunkFromRegion(chunk, cx, cy, cz))
     {
-        for(int cy = 0; cy < 1; cy++)
+        generateChunkTerrain(chunk, cx, cy, cz);
+        placeChunkFeatures(chunk, cx, cy, cz);
+    }
+    chunk->bricksBuilt = false;
+}
+
+Chunk *getChunk(int cx, int cy, int cz)
+{
+    if (cy < 0 || cy >= WORLD_HEIGHT_CHUNKS) return NULL;
+
+    //Chunks are generated the first time anything looks at them
+    Chunk *chunk = createChunk(cx, cy, cz);
+    if (!chunk->generated)
+        fillChunk(chunk, cx, cy, cz);
+    return chunk;
+}
+
+static void evictChunk(Chunk *chunk)
+{
+    chunkMapRemove(&chunkMap, packChunkKey(chunk->cx, chunk->cy, chunk->cz));
+    destroyChunk(chunk);
+}
+
+int getResidentChunkCount(void)
+{
+    return chunkMap.count;
+}
+
+static void runChunkGenTask(void *ctx, int index)
+{
+    ChunkGenTask *task = &((ChunkGenTask *)ctx)[index];
+    fillChunk(task->chunk, task->cx, task->cy, task->cz);
+}
+
+void generateChunks(ThreadPool *pool, ChunkGenTask *tasks, int count)
+{
+    //Chunks only write their own data so any split across threads gives the same world
+    parallelFor(pool, count, runChunkGenTask, tasks);
+}
+
+static void pushColumn(ColumnQueue *queue, int cx, int cz)
+{
+    if (queue->count == queue->capacity)
+    {
+        //Reclaim the popped front before growing
+        if (queue->head > 0)
         {
-            for(int cz = 0; cz < WORLD_SIZE_CHUNKS; cz++)
-            {
-                // Initialize blocks within this chunk
-                for(int x = 0; x < CHUNK_WIDTH; x++)
-                {
-                    for(int y = 0; y < CHUNK_HEIGHT; y++)
-                    {
-                        for(int z = 0; z < CHUNK_WIDTH; z++)
-                        {
-                            //TODO: implement a better noise
-                            // simple sin heightmap
-                            float freq = 0.12f;
-                            float amp  = (CHUNK_HEIGHT * 0.5f);
-                            int baseH  = CHUNK_HEIGHT / 3;
-
-                            int worldX = cx*CHUNK_WIDTH + x;
-                            int worldZ = cz*CHUNK_WIDTH + z;
-                            int height = (int)(((sinf(worldX * freq) + sinf(worldZ * freq * 0.5f)) * 0.5f) * amp) + baseH;
-                            if (height < 0) height = 0;
-                            if (height >= CHUNK_HEIGHT) height = CHUNK_HEIGHT - 1;
-
-                            chunks[cx][cy][cz].blocks[x][y][z] = (y <= height) ? SOLID : AIR;
-                        }
-                    }
-                }
-                //Dont generate yet, only want to when needed.
-                chunks[cx][cy][cz].mesh = (Mesh){0};
-                chunks[cx][cy][cz].model = (Model){0};
-            }
+            memmove(queue->items, queue->items + queue->head, (queue->count - queue->head) * sizeof(ChunkColumn));
+            queue->count -= queue->head;
+            queue->head = 0;
+        }
+        if (queue->count == queue->capacity)
+        {
+            queue->capacity = queue->capacity ? queue->capacity * 2 : 256;
+            queue->items = realloc(queue->items, queue->capacity * sizeof(ChunkColumn));
+        }
+    }
+    queue->items[queue->count++] = (ChunkColumn){ cx, cz };
+}
+
+static long long columnDistance(const ChunkColumn *column)
+{
+    long long dx = column->cx - residentCx;
+    long long dz = column->cz - residentCz;
+    return dx * dx + dz * dz;
+}
+
+static int compareNearestFirst(const void *a, const void *b)
+{
+    long long da = columnDistance(a), db = columnDistance(b);
+    return (da > db) - (da < db);
+}
+
+static int compareFarthestFirst(const void *a, const void *b)
+{
+    return compareNearestFirst(b, a);
+}
+
+static void sortQueue(ColumnQueue *queue, int (*compare)(const void *, const void *))
+{
+    if (queue->count - queue->head < 2) return;
+    qsort(queue->items + queue->head, queue->count - queue->head, sizeof(ChunkColumn), compare);
+}
+
+static bool inSquare(int cx, int cz, int centerX, int centerZ, int radius)
+{
+    return abs(cx - centerX) <= radius && abs(cz - centerZ) <= radius;
+}
+
+//Queues every column of square A that is not in square B (bRadius < 0 for no B).
+//Each row of A loses at most one run to B, so the cost follows the rows and the output, not the area
+static void queueSquareDifference(ColumnQueue *queue, int ax, int az, int aRadius, int bx, int bz, int bRadius)
+{
+    int x0 = ax - aRadius, x1 = ax + aRadius;
+    int z0 = az - aRadius, z1 = az + aRadius;
+
+    for (int cx = x0; cx <= x1; cx++)
+    {
+        if (bRadius < 0 || abs(cx - bx) > bRadius)
+        {
+            for (int cz = z0; cz <= z1; cz++)
+                pushColumn(queue, cx, cz);
+            continue;
         }
+        for (int cz = z0; cz <= z1 && cz < bz - bRadius; cz++)
+            pushColumn(queue, cx, cz);
+        for (int cz = (bz + bRadius + 1 > z0) ? bz + bRadius + 1 : z0; cz <= z1; cz++)
+            pushColumn(queue, cx, cz);
+    }
+}
+
+int chooseChunkLod(int distance, int current)
+{
+    int lod = 0;
+    while (lod < LOD_LEVELS - 1 && distance > (currentLodRadius << lod)) lod++;
+    if (current < 0 || lod <= current) return lod;
+
+    //Finer happens as soon as the column is inside the ring, coarser only once it is well outside
+    int coarser = 0;
+    while (coarser < LOD_LEVELS - 1 && distance > (currentLodRadius << coarser) + LOD_HYSTERESIS) coarser++;
+    return (coarser > current) ? coarser : current;
+}
+
+static int chebyshevDistance(int cx, int cz)
+{
+    int dx = abs(cx - residentCx);
+    int dz = abs(cz - residentCz);
+    return (dx > dz) ? dx : dz;
+}
+
+//Brings one column's layers to the level for distance, rebuilding the meshed ones that change. All layers of a
+//column share one level
+static void levelColumn(int cx, int cz, int distance)
+{
+    lodColumnsChecked++;
+    for (int cy = 0; cy < WORLD_HEIGHT_CHUNKS; cy++)
+    {
+        Chunk *chunk = findChunk(cx, cy, cz);
+        if (chunk == NULL) continue;
+        int lod = chooseChunkLod(distance, chunk->lod);
+        if (lod == chunk->lod) continue;
+        chunk->lod = (uint8_t)lod;
+        if (chunk->meshed || chunk->meshQueued)
+            requestChunkMesh(cx, cy, cz);
     }
 }
 
-void updateVisibleChunks(Vector3 playerChunkPos, Shader fogShader)
+//Whether a column now distance chunks out can have crossed a ring edge, or an edge plus LOD_HYSTERESIS, when the
+//centre moved by moved chunks. Its old distance is within moved of the new one, and a column that stays on the same
+//side of every edge keeps its level
+static bool ringCanChangeLevel(int distance, int moved)
+{
+    for (int lod = 0; lod < LOD_LEVELS - 1; lod++)
+    {
+        int edge = currentLodRadius << lod;
+        if (distance > edge - moved && distance <= edge + moved) return true;
+        if (distance > edge + LOD_HYSTERESIS - moved && distance <= edge + LOD_HYSTERESIS + moved) return true;
+    }
+    return false;
+}
+
+//Rebuilds the meshed columns whose level changed with the player's move. Only the rings around the new centre that
+//can cross an edge are visited, so a step costs the ring perimeters, not the square. The columns that just entered
+//the square, the last entered items of the load queue, may still be resident from before with an old level and are
+//levelled too. The whole square is levelled again when the LOD radius or the render distance changed
+static void updateChunkLods(int oldCx, int oldCz, int oldRadius, int entered)
+{
+    int moveX = abs(residentCx - oldCx), moveZ = abs(residentCz - oldCz);
+    int moved = (moveX > moveZ) ? moveX : moveZ;
+    bool fullPass = leveledLodRadius != currentLodRadius || oldRadius != residentRadius || moved > residentRadius;
+    leveledLodRadius = currentLodRadius;
+
+    if (fullPass)
+    {
+        for (int cx = residentCx - residentRadius; cx <= residentCx + residentRadius; cx++)
+            for (int cz = residentCz - residentRadius; cz <= residentCz + residentRadius; cz++)
+                levelColumn(cx, cz, chebyshevDistance(cx, cz));
+        return;
+    }
+    if (moved == 0) return;
+
+    for (int i = loadQueue.count - entered; i < loadQueue.count; i++)
+        levelColumn(loadQueue.items[i].cx, loadQueue.items[i].cz, chebyshevDistance(loadQueue.items[i].cx, loadQueue.items[i].cz));
+    for (int d = 0; d <= residentRadius; d++)
+    {
+        if (!ringCanChangeLevel(d, moved)) continue;
+        if (d == 0)
+        {
+            levelColumn(residentCx, residentCz, 0);
+            continue;
+        }
+        for (int i = -d; i <= d; i++)
+        {
+            levelColumn(residentCx + i, residentCz - d, d);
+            levelColumn(residentCx + i, residentCz + d, d);
+        }
+        for (int i = -d + 1; i <= d - 1; i++)
+        {
+            levelColumn(residentCx - d, residentCz + i, d);
+            levelColumn(residentCx + d, residentCz + i, d);
+        }
+    }
+}
+
+void updateVisibleChunks(Vector3 playerChunkPos)
 {
     int pcx = (int)playerChunkPos.x;
-    int pcy = (int)playerChunkPos.y;
     int pcz = (int)playerChunkPos.z;
+    int radius = currentRenderDistance;
+
+    //Only the columns that entered the render square or left the unload square (render distance + 2) are queued
+    int queuedLoads = getQueuedChunkLoads();
+    queueSquareDifference(&loadQueue, pcx, pcz, radius, residentCx, residentCz, haveResidentSquare ? residentRadius : -1);
+    int entered = getQueuedChunkLoads() - queuedLoads;
+    if (haveResidentSquare)
+        queueSquareDifference(&unloadQueue, residentCx, residentCz, residentRadius + 2, pcx, pcz, radius + 2);
+
+    int oldCx = residentCx, oldCz = residentCz, oldRadius = haveResidentSquare ? residentRadius : -1;
+    residentCx = pcx;
+    residentCz = pcz;
+    residentRadius = radius;
+    haveResidentSquare = true;
+    updateChunkLods(oldCx, oldCz, oldRadius, entered);
+    sortQueue(&loadQueue, compareNearestFirst);
+    sortQueue(&unloadQueue, compareFarthestFirst);
+}
 
-    for(int cx = pcx - currentRenderDistance; cx <= pcx + currentRenderDistance; cx++)
+static void addGenTask(ChunkGenTask *tasks, int *count, int cx, int cy, int cz)
+{
+    if (cy < 0 || cy >= WORLD_HEIGHT_CHUNKS) return;
+    //Map changes stay on this thread, the workers only fill in terrain
+    Chunk *chunk = createChunk(cx, cy, cz);
+    if (chunk->generated) return;
+    for (int t = 0; t < *count; t++)
+        if (tasks[t].chunk == chunk) return;
+    tasks[(*count)++] = (ChunkGenTask){ chunk, cx, cy, cz };
+}
+
+void processChunkQueues(int maxLoads, int maxUnloads)
+{
+    if (genPool == NULL)
+        genPool = createThreadPool(GEN_WORKER_THREADS > 0 ? GEN_WORKER_THREADS : getCpuCount() - 1);
+
+    //Farthest unloads first. Columns that came back into range since they were queued are skipped
+    for (int done = 0; done < maxUnloads && unloadQueue.head < unloadQueue.count; )
     {
-        for(int cz = pcz - currentRenderDistance; cz <= pcz + currentRenderDistance; cz++)
+        ChunkColumn column = unloadQueue.items[unloadQueue.head++];
+        if (inSquare(column.cx, column.cz, residentCx, residentCz, residentRadius + 2)) continue;
+        for (int cy = 0; cy < WORLD_HEIGHT_CHUNKS; cy++)
         {
-            if (cx < 0 || cx >= WORLD_SIZE_CHUNKS) continue;
-            if (cz < 0 || cz >= WORLD_SIZE_CHUNKS) continue;
-            
-            //If chunk does not exist, generate it
-            if(chunks[cx][pcy][cz].mesh.vertexCount == 0)
+            Chunk *chunk = findChunk(column.cx, cy, column.cz);
+            if (chunk == NULL) continue;
+            done++;
+
+            //Untouched terrain can be regenerated and edits go to the region files.
+            //Edited chunks only stay in memory when nothing is being saved
+            if (!chunk->modified || saveChunkToRegion(chunk))
             {
-                chunks[cx][pcy][cz].mesh = generateChunkMesh(chunks, cx, pcy, cz);
-                chunks[cx][pcy][cz].model = LoadModelFromMesh(chunks[cx][pcy][cz].mesh);
-                chunks[cx][pcy][cz].model.materials[0].shader = fogShader;
+                evictChunk(chunk);
+                continue;
             }
+            releaseChunkMesh(chunk);
+            chunk->meshed = false;
+            chunk->meshQueued = false;
+            chunk->meshVersion = 0; //Drop anything still in flight
+        }
+    }
+    submitRegionWrites();
+
+    //Nearest loads first. Their terrain and the face neighbours the mesher reads are generated as one parallel batch
+    ChunkColumn batch[CHUNK_LOADS_PER_FRAME];
+    int batchCount = 0;
+    if (maxLoads > CHUNK_LOADS_PER_FRAME) maxLoads = CHUNK_LOADS_PER_FRAME;
+    while (batchCount < maxLoads && loadQueue.head < loadQueue.count)
+    {
+        ChunkColumn column = loadQueue.items[loadQueue.head++];
+        if (!inSquare(column.cx, column.cz, residentCx, residentCz, residentRadius)) continue;
+        batch[batchCount++] = column;
+    }
+    if (batchCount == 0) return;
+
+    ChunkGenTask tasks[CHUNK_LOADS_PER_FRAME * 5 * WORLD_HEIGHT_CHUNKS];
+    int taskCount = 0;
+    for (int b = 0; b < batchCount; b++)
+    {
+        for (int cy = 0; cy < WORLD_HEIGHT_CHUNKS; cy++)
+        {
+            addGenTask(tasks, &taskCount, batch[b].cx, cy, batch[b].cz);
+            addGenTask(tasks, &taskCount, batch[b].cx - 1, cy, batch[b].cz);
+            addGenTask(tasks, &taskCount, batch[b].cx + 1, cy, batch[b].cz);
+            addGenTask(tasks, &taskCount, batch[b].cx, cy, batch[b].cz - 1);
+            addGenTask(tasks, &taskCount, batch[b].cx, cy, batch[b].cz + 1);
         }
     }
-    //Unload if outside render distance
-    for(int cx = 0; cx < WORLD_SIZE_CHUNKS; cx++)
+    generateChunks(genPool, tasks, taskCount);
+
+    for (int b = 0; b < batchCount; b++)
     {
-        for(int cz = 0; cz < WORLD_SIZE_CHUNKS; cz++)
+        for (int cy = 0; cy < WORLD_HEIGHT_CHUNKS; cy++)
         {
-            int dx = abs(cx - pcx);
-            int dz = abs(cz - pcz);
-            if ((dx > currentRenderDistance + 2 || dz > currentRenderDistance + 2) && chunks[cx][pcy][cz].mesh.vertexCount > 0)
+            //If chunk has no mesh, queue one on the workers
+            Chunk *chunk = findChunk(batch[b].cx, cy, batch[b].cz);
+            if (!chunk->meshed && !chunk->meshQueued)
             {
-                UnloadModel(chunks[cx][pcy][cz].model);
-                chunks[cx][pcy][cz].mesh = (Mesh){0};
-                chunks[cx][pcy][cz].model = (Model){0};
+                chunk->lod = (uint8_t)chooseChunkLod(chebyshevDistance(batch[b].cx, batch[b].cz), -1);
+                requestChunkMesh(batch[b].cx, cy, batch[b].cz);
             }
         }
     }
 }
 
+int saveModifiedChunks(void)
+{
+    int saved = 0;
+    int cursor = 0;
+    Chunk *chunk;
+    while ((chunk = chunkMapNext(&chunkMap, &cursor)) != NULL)
+        if (chunk->modified && saveChunkToRegion(chunk)) saved++;
+    submitRegionWrites();
+    return saved;
+}
+
+int getQueuedChunkLoads(void)
+{
+    return loadQueue.count - loadQueue.head;
+}
+
+int getQueuedChunkUnloads(void)
+{
+    return unloadQueue.count - unloadQueue.head;
+}
+
+long long getLodColumnsChecked(void)
+{
+    return lodColumnsChecked;
+}
+
+static bool chunkIsUniform(const Chunk *chunk, uint8_t value)
+{
+    for (int s = 0; s < CHUNK_SECTIONS; s++)
+        if (chunk->sections[s].storage != SECTION_UNIFORM || chunk->sections[s].palette[0] != value) return false;
+    return true;
+}
+
+//True when the neighbour in direction face has no air on the side touching this chunk
+static bool neighbourFaceSolid(const Chunk *chunk, int face)
+{
+    static const int step[6][3] = { {1,0,0}, {-1,0,0}, {0,1,0}, {0,-1,0}, {0,0,1}, {0,0,-1} };
+    //Nothing is ever seen from below the world
+    if (face == FACE_NEG_Y && chunk->cy == 0) return true;
+    const Chunk *n = findChunk(chunk->cx + step[face][0], chunk->cy + step[face][1], chunk->cz + step[face][2]);
+    if (n == NULL || !n->generated) return false;
+    if (chunkIsUniform(n, SOLID)) return true;
+
+    //Touching plane of the neighbour: its low side for positive directions, its high side for negative ones
+    bool low = (face & 1) == 0;
+    if (face == FACE_POS_Y || face == FACE_NEG_Y)
+    {
+        int y = low ? 0 : CHUNK_HEIGHT - 1;
+        for (int x = 0; x < CHUNK_WIDTH; x++)
+            for (int z = 0; z < CHUNK_WIDTH; z++)
+                if (getChunkBlock(n, x, y, z) == AIR) return false;
+        return true;
+    }
+    int edge = low ? 0 : CHUNK_WIDTH - 1;
+    for (int i = 0; i < CHUNK_WIDTH; i++)
+    {
+        for (int y = 0; y < CHUNK_HEIGHT; y++)
+        {
+            int block = (face == FACE_POS_X || face == FACE_NEG_X) ? getChunkBlock(n, edge, y, i) : getChunkBlock(n, i, y, edge);
+            if (block == AIR) return false;
+        }
+    }
+    return true;
+}
+
+bool chunkHasNoFaces(const Chunk *chunk, uint16_t *visibility)
+{
+    if (chunkIsUniform(chunk, AIR))
+    {
+        *visibility = VISIBILITY_ALL;
+        return true;
+    }
+    if (!chunkIsUniform(chunk, SOLID)) return false;
+    for (int face = 0; face < 6; face++)
+        if (!neighbourFaceSolid(chunk, face)) return false;
+    *visibility = 0;
+    return true;
+}
+
+void printChunkMemoryReport(void)
+{
+    size_t before = sizeof(int) * CHUNK_WIDTH * CHUNK_HEIGHT * CHUNK_WIDTH;
+    size_t total = 0;
+    int counts[3] = {0};
+    int chunkCount = 0;
+    int airChunks = 0, solidChunks = 0;
+
+    int cursor = 0;
+    const Chunk *chunk;
+    while ((chunk = chunkMapNext(&chunkMap, &cursor)) != NULL)
+    {
+        if (!chunk->generated) continue;
+        chunkCount++;
+        if (chunkIsUniform(chunk, AIR)) airChunks++;
+        else if (chunkIsUniform(chunk, SOLID)) solidChunks++;
+        for (int s = 0; s < CHUNK_SECTIONS; s++)
+        {
+            const ChunkSection *section = &chunk->sections[s];
+            total += sectionMemoryBytes(section);
+            counts[section->storage]++;
+        }
+    }
+
+    if (chunkCount == 0) return;
+    printf("Chunk memory: %d chunks resident, %zu bytes/chunk before (int blocks), %zu bytes/chunk after, %.1f MB total\n",
+        chunkCount, before, total / chunkCount, total / (1024.0 * 1024.0));
+    printf("Sections: %d uniform, %d palette, %d bytes\n", counts[SECTION_UNIFORM], counts[SECTION_PALETTE], counts[SECTION_BYTES]);
+    printf("Chunks: %d all air, %d all solid, %zu bytes each when uniform\n", airChunks, solidChunks, sizeof(Chunk));
+}
+
+BoundingBox getChunkBounds(const Chunk *chunk)
+{
+    Vector3 origin = (Vector3){ chunk->cx * CHUNK_WIDTH, chunk->cy * CHUNK_HEIGHT, chunk->cz * CHUNK_WIDTH };
+    return (BoundingBox){
+        (Vector3){ origin.x, origin.y + chunk->minY, origin.z },
+        (Vector3){ origin.x + CHUNK_WIDTH, origin.y + chunk->maxY + 1, origin.z + CHUNK_WIDTH }
+    };
+}
+
 Vector3 getPlayerChunkPos(Camera camera)
 {
-    int cx = floor_div((int)camera.position.x, CHUNK_WIDTH);
-    int cy = 0;
-    int cz = floor_div((int)camera.position.z, CHUNK_WIDTH);    
+    int cx = floor_div((int)floorf(camera.position.x), CHUNK_WIDTH);
+    int cy = floor_div((int)floorf(camera.position.y), CHUNK_HEIGHT);
+    int cz = floor_div((int)floorf(camera.position.z), CHUNK_WIDTH);
 
     return (Vector3){(float)cx, (float)cy, (float)cz}; 
 }
@@ -140,9 +645,7 @@ int getBlockAtWorld(int wx, int wy, int wz)
     int cy = floor_div(wy, CHUNK_HEIGHT);
     int cz = floor_div(wz, CHUNK_WIDTH);
 
-    if (cy < 0 || cy >= 1) return 0;
-    if (cx < 0 || cx >= WORLD_SIZE_CHUNKS) return 0;
-    if (cz < 0 || cz >= WORLD_SIZE_CHUNKS) return 0;
+    if (cy < 0 || cy >= WORLD_HEIGHT_CHUNKS) return 0;
 
     int lx = wx - cx * CHUNK_WIDTH;
     int ly = wy - cy * CHUNK_HEIGHT;
@@ -152,15 +655,53 @@ int getBlockAtWorld(int wx, int wy, int wz)
     if (ly < 0 || ly >= CHUNK_HEIGHT) return 0;
     if (lz < 0 || lz >= CHUNK_WIDTH) return 0;
 
-    return chunks[cx][cy][cz].blocks[lx][ly][lz];
+    return getChunkBlock(getChunk(cx, cy, cz), lx, ly, lz);
 }
 
-int setBlockAtWorld(int wx, int wy, int wz, int blockID, BlockFace placeface, Shader fogShader)
+//Only chunks that already have (or are getting) a mesh need rebuilding after an edit.
+//They are queued once however many edits land before the next flushDirtyChunks
+static void markChunkDirty(Chunk *chunk)
 {
-    int cx = floor_div(wx, CHUNK_WIDTH);
-    int cy = floor_div(wy, CHUNK_HEIGHT);
-    int cz = floor_div(wz, CHUNK_WIDTH);
+    if (chunk == NULL || chunk->dirty || !(chunk->meshed || chunk->meshQueued)) return;
+    chunk->dirty = true;
+    if (dirtyCount == dirtyCapacity)
+    {
+        dirtyCapacity = dirtyCapacity ? dirtyCapacity * 2 : 64;
+        dirtyChunks = realloc(dirtyChunks, dirtyCapacity * sizeof(DirtyChunk));
+    }
+    dirtyChunks[dirtyCount++] = (DirtyChunk){ chunk->cx, chunk->cy, chunk->cz };
+}
+
+//Neighbours read the edited border through their snapshots. Ones that are not resident have no mesh to fix
+static void markBordersDirty(const Chunk *chunk, int lx0, int ly0, int lz0, int lx1, int ly1, int lz1)
+{
+    if (lx0 == 0) markChunkDirty(findChunk(chunk->cx - 1, chunk->cy, chunk->cz));
+    if (lx1 == CHUNK_WIDTH - 1) markChunkDirty(findChunk(chunk->cx + 1, chunk->cy, chunk->cz));
+    if (ly0 == 0) markChunkDirty(findChunk(chunk->cx, chunk->cy - 1, chunk->cz));
+    if (ly1 == CHUNK_HEIGHT - 1) markChunkDirty(findChunk(chunk->cx, chunk->cy + 1, chunk->cz));
+    if (lz0 == 0) markChunkDirty(findChunk(chunk->cx, chunk->cy, chunk->cz - 1));
+    if (lz1 == CHUNK_WIDTH - 1) markChunkDirty(findChunk(chunk->cx, chunk->cy, chunk->cz + 1));
+}
+
+int flushDirtyChunks(void)
+{
+    int requested = 0;
+    for (int i = 0; i < dirtyCount; i++)
+    {
+        //Evicted since it was marked, or evicted and loaded again as a clean chunk
+        Chunk *chunk = findChunk(dirtyChunks[i].cx, dirtyChunks[i].cy, dirtyChunks[i].cz);
+        if (chunk == NULL || !chunk->dirty) continue;
+        chunk->dirty = false;
+        requestChunkMesh(chunk->cx, chunk->cy, chunk->cz);
+        requested++;
+    }
+    dirtyCount = 0;
+    return requested;
+}
 
+int setBlockAtWorld(int wx, int wy, int wz, int blockID, BlockFace placeface)
+{
+    //Placing goes into the block next to the face that was hit
     switch(placeface)
     {
         case FACE_NEG_X: wx -=1; break;
@@ -169,55 +710,138 @@ int setBlockAtWorld(int wx, int wy, int wz, int blockID, BlockFace placeface, Sh
         case FACE_POS_Y: wy +=1; break;
         case FACE_NEG_Z: wz -=1; break;
         case FACE_POS_Z: wz +=1; break;
+        default: break;
     }
 
-    if (cy < 0 || cy >= 1) return 0;
-    if (cx < 0 || cx >= WORLD_SIZE_CHUNKS) return 0;
-    if (cz < 0 || cz >= WORLD_SIZE_CHUNKS) return 0;
+    int cx = floor_div(wx, CHUNK_WIDTH);
+    int cy = floor_div(wy, CHUNK_HEIGHT);
+    int cz = floor_div(wz, CHUNK_WIDTH);
+    if (cy < 0 || cy >= WORLD_HEIGHT_CHUNKS) return 0;
     int lx = wx - cx * CHUNK_WIDTH;
     int ly = wy - cy * CHUNK_HEIGHT;
     int lz = wz - cz * CHUNK_WIDTH;
 
-    if (lx < 0 || lx >= CHUNK_WIDTH) return 0;
-    if (ly < 0 || ly >= CHUNK_HEIGHT) return 0;
-    if (lz < 0 || lz >= CHUNK_WIDTH) return 0;
+    Chunk *chunk = getChunk(cx, cy, cz);
+    if (getChunkBlock(chunk, lx, ly, lz) == blockID) return 1;
+    setChunkBlock(chunk, lx, ly, lz, blockID);
+    chunk->modified = true;
 
-    chunks[cx][cy][cz].blocks[lx][ly][lz] = blockID;
+    //The old meshes draw until the rebuilt ones land
+    markChunkDirty(chunk);
+    markBordersDirty(chunk, lx, ly, lz, lx, ly, lz);
+    return 1;
+}
 
-    //Regenerate mesh for affected chunk/s (Regenerate neighboring chunks if on edge)
-    //TODO: Make sure this cant go out of bounds. I think this is fine when it is moved to infinite world
-    if(lx == 15)
-    {
-        UnloadModel(chunks[cx+1][cy][cz].model);
-        chunks[cx+1][cy][cz].mesh = generateChunkMesh(chunks, cx+1, cy, cz);
-        chunks[cx+1][cy][cz].model = LoadModelFromMesh(chunks[cx+1][cy][cz].mesh);
-        chunks[cx+1][cy][cz].model.materials[0].shader = fogShader;
-    } 
-    else if(lx == 0)
-    {
-        UnloadModel(chunks[cx-1][cy][cz].model);
-        chunks[cx-1][cy][cz].mesh = generateChunkMesh(chunks, cx-1, cy, cz);
-        chunks[cx-1][cy][cz].model = LoadModelFromMesh(chunks[cx-1][cy][cz].mesh);
-        chunks[cx-1][cy][cz].model.materials[0].shader = fogShader;
-    }
-    if(lz == 15)
-    {
-        UnloadModel(chunks[cx][cy][cz+1].model);
-        chunks[cx][cy][cz+1].mesh = generateChunkMesh(chunks, cx, cy, cz+1);
-        chunks[cx][cy][cz+1].model = LoadModelFromMesh(chunks[cx][cy][cz+1].mesh);
-        chunks[cx][cy][cz+1].model.materials[0].shader = fogShader;
-    }
-    else if(lz == 0)
+typedef bool (*BlockFilter)(int wx, int wy, int wz, const void *ctx);
+
+static void growBounds(int *min, int *max, int x0, int y0, int z0, int x1, int y1, int z1)
+{
+    if (x0 < min[0]) min[0] = x0;
+    if (y0 < min[1]) min[1] = y0;
+    if (z0 < min[2]) min[2] = z0;
+    if (x1 > max[0]) max[0] = x1;
+    if (y1 > max[1]) max[1] = y1;
+    if (z1 > max[2]) max[2] = z1;
+}
+
+//The part of the world box inside one chunk
+static int editChunkBox(Chunk *chunk, int x0, int y0, int z0, int x1, int y1, int z1, int blockID, BlockFilter filter, const void *ctx)
+{
+    int ox = chunk->cx * CHUNK_WIDTH, oy = chunk->cy * CHUNK_HEIGHT, oz = chunk->cz * CHUNK_WIDTH;
+    int lx0 = x0 > ox ? x0 - ox : 0, lx1 = x1 < ox + CHUNK_WIDTH - 1 ? x1 - ox : CHUNK_WIDTH - 1;
+    int ly0 = y0 > oy ? y0 - oy : 0, ly1 = y1 < oy + CHUNK_HEIGHT - 1 ? y1 - oy : CHUNK_HEIGHT - 1;
+    int lz0 = z0 > oz ? z0 - oz : 0, lz1 = z1 < oz + CHUNK_WIDTH - 1 ? z1 - oz : CHUNK_WIDTH - 1;
+
+    int changed = 0;
+    //Bounds of the blocks that actually changed, only neighbours on those borders need rebuilding
+    int min[3] = { CHUNK_WIDTH, CHUNK_HEIGHT, CHUNK_WIDTH }, max[3] = { -1, -1, -1 };
+    uint8_t raw[SECTION_VOLUME];
+    for (int s = ly0 / SECTION_HEIGHT; s <= ly1 / SECTION_HEIGHT; s++)
     {
-        UnloadModel(chunks[cx][cy][cz-1].model);
-        chunks[cx][cy][cz-1].mesh = generateChunkMesh(chunks, cx, cy, cz-1);
-        chunks[cx][cy][cz-1].model = LoadModelFromMesh(chunks[cx][cy][cz-1].mesh);
-        chunks[cx][cy][cz-1].model.materials[0].shader = fogShader;
+        ChunkSection *section = &chunk->sections[s];
+        if (section->storage == SECTION_UNIFORM && section->palette[0] == blockID) continue;
+        int sy = s * SECTION_HEIGHT;
+        int bottom = ly0 > sy ? ly0 - sy : 0;
+        int top = ly1 < sy + SECTION_HEIGHT - 1 ? ly1 - sy : SECTION_HEIGHT - 1;
+        unpackSection(section, raw);
+
+        //A fully covered section becomes uniform without being repacked
+        if (filter == NULL && lx0 == 0 && lx1 == CHUNK_WIDTH - 1 && lz0 == 0 && lz1 == CHUNK_WIDTH - 1
+            && bottom == 0 && top == SECTION_HEIGHT - 1)
+        {
+            int sectionChanged = 0;
+            for (int idx = 0; idx < SECTION_VOLUME; idx++)
+                sectionChanged += raw[idx] != blockID;
+            freeSection(section);
+            initSection(section, (uint8_t)blockID);
+            if (sectionChanged > 0) growBounds(min, max, 0, sy, 0, CHUNK_WIDTH - 1, sy + SECTION_HEIGHT - 1, CHUNK_WIDTH - 1);
+            changed += sectionChanged;
+            continue;
+        }
+
+        int sectionChanged = 0;
+        for (int y = bottom; y <= top; y++)
+            for (int z = lz0; z <= lz1; z++)
+                for (int x = lx0; x <= lx1; x++)
+                {
+                    int idx = SECTION_INDEX(x, y, z);
+                    if (raw[idx] == blockID) continue;
+                    if (filter != NULL && !filter(ox + x, oy + sy + y, oz + z, ctx)) continue;
+                    raw[idx] = (uint8_t)blockID;
+                    growBounds(min, max, x, sy + y, z, x, sy + y, z);
+                    sectionChanged++;
+                }
+        if (sectionChanged > 0) packSection(section, raw);
+        changed += sectionChanged;
     }
+    if (changed == 0) return 0;
 
-    UnloadModel(chunks[cx][cy][cz].model);
-    chunks[cx][cy][cz].mesh = generateChunkMesh(chunks, cx, cy, cz);
-    chunks[cx][cy][cz].model = LoadModelFromMesh(chunks[cx][cy][cz].mesh);
-    chunks[cx][cy][cz].model.materials[0].shader = fogShader;
-    return 1;
+    chunk->bricksBuilt = false;
+    chunk->modified = true;
+    markChunkDirty(chunk);
+    markBordersDirty(chunk, min[0], min[1], min[2], max[0], max[1], max[2]);
+    return changed;
+}
+
+//Writes blockID over the world box, or the part of it filter accepts, one section at a time.
+//Returns the number of blocks that changed
+static int editBox(int x0, int y0, int z0, int x1, int y1, int z1, int blockID, BlockFilter filter, const void *ctx)
+{
+    if (x0 > x1) { int t = x0; x0 = x1; x1 = t; }
+    if (y0 > y1) { int t = y0; y0 = y1; y1 = t; }
+    if (z0 > z1) { int t = z0; z0 = z1; z1 = t; }
+    if (y0 < 0) y0 = 0;
+    if (y1 >= WORLD_HEIGHT) y1 = WORLD_HEIGHT - 1;
+    if (y0 > y1) return 0;
+
+    int changed = 0;
+    for (int cx = floor_div(x0, CHUNK_WIDTH); cx <= floor_div(x1, CHUNK_WIDTH); cx++)
+        for (int cy = floor_div(y0, CHUNK_HEIGHT); cy <= floor_div(y1, CHUNK_HEIGHT); cy++)
+            for (int cz = floor_div(z0, CHUNK_WIDTH); cz <= floor_div(z1, CHUNK_WIDTH); cz++)
+                changed += editChunkBox(getChunk(cx, cy, cz), x0, y0, z0, x1, y1, z1, blockID, filter, ctx);
+    return changed;
+}
+
+int fillRegion(int x0, int y0, int z0, int x1, int y1, int z1, int blockID)
+{
+    return editBox(x0, y0, z0, x1, y1, z1, blockID, NULL, NULL);
+}
+
+typedef struct Sphere {
+    int x, y, z;
+    int radiusSquared;
+} Sphere;
+
+static bool insideSphere(int wx, int wy, int wz, const void *ctx)
+{
+    const Sphere *sphere = ctx;
+    int dx = wx - sphere->x, dy = wy - sphere->y, dz = wz - sphere->z;
+    return dx * dx + dy * dy + dz * dz <= sphere->radiusSquared;
+}
+
+int carveSphere(int wx, int wy, int wz, int radius)
+{
+    if (radius < 0) return 0;
+    Sphere sphere = { wx, wy, wz, radius * radius };
+    return editBox(wx - radius, wy - radius, wz - radius, wx + radius, wy + radius, wz + radius, AIR, insideSphere, &sphere);
 }
\ No newline at end of file
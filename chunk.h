@@ -3,29 +3,98 @@
 
 #include "raylib.h"
 #include "config.h"
+#include "section.h"
+#include "render.h"
 #include <stdbool.h>
+#include <stdint.h>
+
+#define BRICK_SIZE 4 //Edge of the occupancy bricks ray queries skip, a section's bricks fill one 64 bit word
+#define BRICK_INDEX(x, y, z) (((((y) % SECTION_HEIGHT) / BRICK_SIZE * (CHUNK_WIDTH / BRICK_SIZE) + (z) / BRICK_SIZE) * (CHUNK_WIDTH / BRICK_SIZE)) + (x) / BRICK_SIZE)
 
 typedef struct Chunk {
-    int blocks[CHUNK_WIDTH][CHUNK_HEIGHT][CHUNK_WIDTH];
-    Mesh mesh;
-    Model model;
+    int cx, cy, cz;
+    ChunkSection sections[CHUNK_SECTIONS];
+    Model model;       //One mesh per MAX_QUADS_PER_MESH quads
+    PackedMesh packed; //Used instead of model when CHUNK_PACKED_VERTICES is on
+    bool generated; //Terrain is filled lazily the first time the chunk is touched
+    bool modified;  //Edited since generation or the last save. Saved before eviction, kept in memory if saving is off
+    bool meshed;    //model/packed hold the latest finished build (may be empty)
+    bool meshQueued; //A rebuild is in flight, the old model keeps drawing until it lands
+    bool dirty;     //Edited since its last build request, rebuilt by the next flushDirtyChunks
+    unsigned int meshVersion; //Id of the latest build request, 0 after an unload, so stale builds get dropped
+    int minY, maxY; //Lowest and highest occupied block rows of the latest mesh, for the culling box
+    uint16_t visibility; //Face pairs linked through air as of the latest mesh, see visibility.h
+    uint8_t lod;     //Level the next build uses (0 = full), follows the distance to the player
+    uint8_t meshLod; //Level of the mesh currently uploaded
+    unsigned int visibleStamp; //Matches findVisibleChunks' return value when the chunk may be seen this frame
+    uint64_t bricks[CHUNK_SECTIONS]; //Bit BRICK_INDEX set when that brick holds anything but air, see getChunkBricks
+    bool bricksBuilt; //bricks match the blocks. Cleared by edits that can empty a brick
 } Chunk;
 
 typedef enum BlockVal {
     AIR,
-    SOLID
+    SOLID,
+    WOOD,
+    LEAVES
 } BlockVal;
 
-extern Chunk ***chunks;
+typedef struct ChunkGenTask {
+    Chunk *chunk;
+    int cx, cy, cz;
+} ChunkGenTask;
+
+struct ThreadPool;
+
 extern int currentRenderDistance;
+extern int currentLodRadius; //Starts at LOD_RADIUS, the render distance controller may pull it in
 
-void allocateChunks(int worldSize);
-void freeChunks(int worldSize);
-void initChunks();
+//Chunks live in a hash map around the player, the world has no edges in x and z
+void initChunks(void);
+void freeChunks(void);
+void generateChunkTerrain(Chunk *chunk, int cx, int cy, int cz);
+//Generates the chunk on first use. NULL only above or below the world
+Chunk *getChunk(int cx, int cy, int cz);
+//Resident chunks only, never generates
+Chunk *findChunk(int cx, int cy, int cz);
+int getResidentChunkCount(void);
+//Fills every task's terrain across the pool, output does not depend on thread count. pool may be NULL
+void generateChunks(struct ThreadPool *pool, ChunkGenTask *tasks, int count);
 Vector3 getPlayerChunkPos(Camera camera);
-void updateVisibleChunks(Vector3 playerChunkPos, Shader fogShader);
+//Queues the columns that entered or left the view since the last call and rebuilds the ones whose level changed.
+//Cost follows the render distance only, unless the LOD radius or the render distance changed
+void updateVisibleChunks(Vector3 playerChunkPos);
+//Mesh level for a column distance chunks from the player (larger of |dx| and |dz|). current < 0 for a column
+//without a level yet, otherwise a coarser level waits LOD_HYSTERESIS chunks past the ring edge so walking
+//along it does not rebuild the same columns back and forth
+int chooseChunkLod(int distance, int current);
+//Works off part of the queues: unloads farthest first, generates and requests meshes for the nearest loads
+void processChunkQueues(int maxLoads, int maxUnloads);
+//Queues every edited resident chunk for the region writer, returns how many
+int saveModifiedChunks(void);
+int getQueuedChunkLoads(void);
+int getQueuedChunkUnloads(void);
+//Columns updateVisibleChunks has checked for a new level so far
+long long getLodColumnsChecked(void);
+void printChunkMemoryReport(void);
+//All air, or all solid with no air on any neighbouring face: meshing would give no quads. visibility gets the face links
+bool chunkHasNoFaces(const Chunk *chunk, uint16_t *visibility);
+//World space box around the chunk's occupied rows, valid once it has been meshed
+BoundingBox getChunkBounds(const Chunk *chunk);
+
+//Chunk local block access, all reads and writes of block data go through these
+int getChunkBlock(const Chunk *chunk, int x, int y, int z);
+void setChunkBlock(Chunk *chunk, int x, int y, int z, int blockID);
+//Brick occupancy words, one per section, rebuilt here on first use after an edit. Main thread only
+const uint64_t *getChunkBricks(Chunk *chunk);
 
+//World block access. Edits only mark the chunk (and any neighbour sharing the edited border) dirty,
+//flushDirtyChunks then requests one rebuild per dirty chunk. Nothing above or below the world is written
 int getBlockAtWorld(int wx, int wy, int wz);
-int setBlockAtWorld(int wx, int wy, int wz, int blockID, BlockFace placeface, Shader fogShader);
+int setBlockAtWorld(int wx, int wy, int wz, int blockID, BlockFace placeface);
+//Bulk edits, corners inclusive and in any order. Return the number of blocks that changed
+int fillRegion(int x0, int y0, int z0, int x1, int y1, int z1, int blockID);
+int carveSphere(int wx, int wy, int wz, int radius);
+//Once per frame, returns the number of rebuilds requested
+int flushDirtyChunks(void);
 
 #endif
\ No newline at end of file
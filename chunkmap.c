@@ -0,0 +1,126 @@
+#include "chunkmap.h"
+#include <stdlib.h>
+#include <string.h>
+
+uint64_t packChunkKey(int cx, int cy, int cz)
+{
+    return ((uint64_t)((uint32_t)cx & 0xFFFFFFF) << 36)
+         | ((uint64_t)((uint32_t)cz & 0xFFFFFFF) << 8)
+         | ((uint32_t)cy & 0xFF);
+}
+
+static uint64_t hashKey(uint64_t key)
+{
+    //Fibonacci hashing, neighbouring chunks land far apart
+    return key * 0x9E3779B97F4A7C15ULL;
+}
+
+static int slotIndex(const ChunkMap *map, uint64_t key)
+{
+    return (int)(hashKey(key) >> 32) & (map->capacity - 1);
+}
+
+static int cacheIndex(uint64_t key)
+{
+    return (int)(hashKey(key) >> 58) & (CHUNK_MAP_CACHE_SIZE - 1);
+}
+
+void initChunkMap(ChunkMap *map, int capacity)
+{
+    int size = 16;
+    while (size < capacity) size *= 2;
+    memset(map, 0, sizeof(*map));
+    map->capacity = size;
+    map->slots = calloc(size, sizeof(ChunkMapSlot));
+}
+
+void freeChunkMap(ChunkMap *map)
+{
+    free(map->slots);
+    memset(map, 0, sizeof(*map));
+}
+
+struct Chunk *chunkMapProbe(const ChunkMap *map, uint64_t key)
+{
+    for (int i = slotIndex(map, key); ; i = (i + 1) & (map->capacity - 1))
+    {
+        const ChunkMapSlot *slot = &map->slots[i];
+        if (slot->chunk == NULL) return NULL;
+        if (slot->key == key) return slot->chunk;
+    }
+}
+
+struct Chunk *chunkMapGet(ChunkMap *map, uint64_t key)
+{
+    ChunkMapSlot *cached = &map->cache[cacheIndex(key)];
+    if (cached->chunk != NULL && cached->key == key) return cached->chunk;
+
+    struct Chunk *chunk = chunkMapProbe(map, key);
+    if (chunk != NULL)
+        *cached = (ChunkMapSlot){ key, chunk };
+    return chunk;
+}
+
+static void placeSlot(ChunkMap *map, uint64_t key, struct Chunk *chunk)
+{
+    int i = slotIndex(map, key);
+    while (map->slots[i].chunk != NULL)
+        i = (i + 1) & (map->capacity - 1);
+    map->slots[i] = (ChunkMapSlot){ key, chunk };
+}
+
+void chunkMapInsert(ChunkMap *map, uint64_t key, struct Chunk *chunk)
+{
+    //Keep the load under a half so probe runs stay short
+    if ((map->count + 1) * 2 > map->capacity)
+    {
+        ChunkMapSlot *old = map->slots;
+        int oldCapacity = map->capacity;
+        map->capacity *= 2;
+        map->slots = calloc(map->capacity, sizeof(ChunkMapSlot));
+        for (int i = 0; i < oldCapacity; i++)
+            if (old[i].chunk != NULL)
+                placeSlot(map, old[i].key, old[i].chunk);
+        free(old);
+    }
+    placeSlot(map, key, chunk);
+    map->count++;
+}
+
+struct Chunk *chunkMapRemove(ChunkMap *map, uint64_t key)
+{
+    int mask = map->capacity - 1;
+    int i = slotIndex(map, key);
+    while (map->slots[i].chunk != NULL && map->slots[i].key != key)
+        i = (i + 1) & mask;
+    struct Chunk *removed = map->slots[i].chunk;
+    if (removed == NULL) return NULL;
+
+    ChunkMapSlot *cached = &map->cache[cacheIndex(key)];
+    if (cached->key == key) cached->chunk = NULL;
+
+    //Backward shift: pull later entries of the run into the hole unless that would move them before their home slot
+    int hole = i;
+    for (int j = (i + 1) & mask; map->slots[j].chunk != NULL; j = (j + 1) & mask)
+    {
+        int home = slotIndex(map, map->slots[j].key);
+        if (((j - home) & mask) >= ((j - hole) & mask))
+        {
+            map->slots[hole] = map->slots[j];
+            hole = j;
+        }
+    }
+    map->slots[hole] = (ChunkMapSlot){0};
+    map->count--;
+    return removed;
+}
+
+struct Chunk *chunkMapNext(const ChunkMap *map, int *cursor)
+{
+    while (*cursor < map->capacity)
+    {
+        struct Chunk *chunk = map->slots[(*cursor)++].chunk;
+        if (chunk != NULL) return chunk;
+    }
+    return NULL;
+}
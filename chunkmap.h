@@ -0,0 +1,41 @@
+#ifndef CHUNKMAP_H
+#define CHUNKMAP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define CHUNK_MAP_CACHE_SIZE 64 //Direct mapped entries in front of the table, power of two
+
+struct Chunk;
+
+//Open addressed (linear probing) table of heap allocated chunks keyed by packed chunk coordinates.
+//Chunk pointers stay valid while the table grows. Main thread only
+typedef struct ChunkMapSlot {
+    uint64_t key;
+    struct Chunk *chunk; //NULL = empty slot
+} ChunkMapSlot;
+
+typedef struct ChunkMap {
+    ChunkMapSlot *slots;
+    int capacity; //Power of two
+    int count;
+    ChunkMapSlot cache[CHUNK_MAP_CACHE_SIZE]; //Recent hits, checked before probing
+} ChunkMap;
+
+//28 bits each for cx and cz, 8 for cy
+uint64_t packChunkKey(int cx, int cy, int cz);
+
+void initChunkMap(ChunkMap *map, int capacity);
+//Frees the table only, the chunks belong to the caller
+void freeChunkMap(ChunkMap *map);
+struct Chunk *chunkMapGet(ChunkMap *map, uint64_t key);
+//Table lookup without the cache in front
+struct Chunk *chunkMapProbe(const ChunkMap *map, uint64_t key);
+//Key must not be present yet
+void chunkMapInsert(ChunkMap *map, uint64_t key, struct Chunk *chunk);
+//Returns the removed chunk, NULL when the key was not there
+struct Chunk *chunkMapRemove(ChunkMap *map, uint64_t key);
+//Iteration: start with *cursor = 0, returns NULL when done. The map must not change meanwhile
+struct Chunk *chunkMapNext(const ChunkMap *map, int *cursor);
+
+#endif
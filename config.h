@@ -6,19 +6,65 @@
 #define TARGET_FPS 2000
 #define SCREEN_WIDTH 1600
 #define SCREEN_HEIGHT 900
+#define RENDER_PIXEL_SIZE 5 //Screen pixels per side of each pixel the 3D pass renders, 1 = full resolution
+#define RENDER_PIXEL_SIZE_MAX 10 //- and = step between 1 and this at runtime
 //Player
 #define CAMERA_FOV 90.0f
 #define MAX_REACH 8.0f
+#define PHYSICS_STEP (1.0f / 120.0f) //Seconds per physics step, bodies move the same at any frame rate
+#define PHYSICS_MAX_STEPS 8 //Per frame, frame time past that is dropped
 #define CROSSHAIR_COLOR SKYBLUE
 //Chunk
 #define CHUNK_WIDTH 16
 #define CHUNK_HEIGHT 64
+#define SECTION_HEIGHT 16 //Chunks are stored as CHUNK_HEIGHT / SECTION_HEIGHT palette sections
 #define DEFAULT_RENDER_DISTANCE 10
-#define WORLD_SIZE_CHUNKS 100 //100 x 100 Chunk World Size
+#define SPAWN_CHUNK 50 //Player starts over chunk (50, 50)
+#define WORLD_HEIGHT_CHUNKS 4 //Chunks stacked vertically
+#define WORLD_HEIGHT (WORLD_HEIGHT_CHUNKS * CHUNK_HEIGHT)
+#define GEN_WORKER_THREADS 0 //0 = one per core alongside the main thread
+#define CHUNK_LOADS_PER_FRAME 16 //Columns generated and sent to the meshers per frame
+#define CHUNK_UNLOADS_PER_FRAME 64 //Chunk meshes released per frame
+#define LOD_RADIUS 8 //Columns this many chunks from the player get full meshes, each doubling of the distance halves the resolution
+#define LOD_LEVELS 4 //Full, 2x, 4x and 8x blocks per cell
+#define LOD_HYSTERESIS 1 //Chunks a column has to be past a ring edge before it is rebuilt coarser
+#define ADAPTIVE_RENDER_DISTANCE 1 //1 = render distance (then LOD radius) follows the frame time, 0 = fixed at DEFAULT_RENDER_DISTANCE
+#define FRAME_BUDGET_MS 8.0f //Frame time the adaptive render distance holds
+#define RENDER_DISTANCE_MIN 4
+#define RENDER_DISTANCE_MAX 24
+#define LOD_RADIUS_MIN 2 //The LOD radius only shrinks once the render distance is at its minimum
+#define RENDER_DISTANCE_WINDOW 60 //Frames averaged per decision
+#define RENDER_DISTANCE_BACKLOG 128 //Queued loads + pending meshes above which frames measure loading, not the distance, and are skipped
+#define WORLD_DIRECTORY "world" //Region files with the player's edits, relative to the working directory
+#define WORLD_AUTOSAVE_SECONDS 30.0 //Edited chunks still in range are written this often
+//Terrain
+#define TERRAIN_SEED 1337u
+#define TERRAIN_OCTAVES 5
+#define TERRAIN_FREQUENCY (1.0f / 160.0f) //Lattice cells per block of the first octave, each next octave doubles it
+#define TERRAIN_GAIN 0.5f //Amplitude of each octave relative to the one before
+#define TERRAIN_AMPLITUDE 48.0f //Blocks the surface moves above and below WORLD_HEIGHT / 3
+#define TERRAIN_TREE_SITES 3 //Spots per chunk column that may grow a tree
+#define TERRAIN_TREE_CHANCE 40 //Percent of the spots that do
+//Meshing
+#define MESH_WORKER_THREADS 0 //0 = one per core minus the render thread
+#define MESHER_BINARY 1 //1 = bitmask column mesher, 0 = per voxel greedyMesh
+#define CHUNK_PACKED_VERTICES 1 //1 = 4 byte vertices drawn with shader/chunk.vs, 0 = raylib Mesh/Model with float attributes
+#define CHUNK_BATCHING 1 //1 = packed meshes share one vertex buffer per BATCH_SIZE x BATCH_SIZE columns, 0 = a buffer and draw per chunk
+#define BATCH_SIZE 4 //Columns per batch side, BATCH_SIZE * CHUNK_WIDTH must fit in a byte and a batch's columns in a 32 bit mask
+_Static_assert(BATCH_SIZE * CHUNK_WIDTH <= 255, "Packed vertex positions inside a batch are one byte per axis, up to the far side of the batch");
+_Static_assert(BATCH_SIZE * BATCH_SIZE <= 32, "visibleMask has one bit per batch slot");
+#define MESH_UPLOAD_BUDGET_BYTES (4 * 1024 * 1024) //GPU upload per frame, at least one mesh always goes up
+#define MESH_CACHE_BYTES (32 * 1024 * 1024) //CPU copies of recent packed meshes for chunks that come back unchanged, 0 = off
+#define MESH_CACHE_SPILL 0 //1 = meshes pushed out of the cache go to WORLD_DIRECTORY/meshes.cache instead of being dropped
+#define MESH_CACHE_SPILL_BYTES (256 * 1024 * 1024) //The spill file starts over past this size
 //Shader
 #define GLSL_VERSION 330
 #define SKY_COLOR SKYBLUE
 #define FOG_VALUE .0125f
+#define FOG_OFF 0
+#define FOG_PER_VERTEX 1 //Worked out at the corners of each quad and interpolated, differs from per fragment only across big quads
+#define FOG_PER_FRAGMENT 2
+#define FOG_QUALITY FOG_PER_VERTEX //Compiled into the chunk shaders at load, F cycles it with packed vertices
 
 typedef enum BlockFace {
     FACE_POS_X,
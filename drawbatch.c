@@ -0,0 +1,309 @@
+#include "drawbatch.h"
+#include "render.h"
+#include "chunkmap.h"
+#include "config.h"
+#include "rlgl.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DRAW_BATCH_BUCKETS 256 //Chained, a render square at the default distance needs well under a hundred per layer
+#define BATCH_SLOTS (BATCH_SIZE * BATCH_SIZE)
+#define BATCH_MIN_VERTICES (16 * 1024) //First buffer of a batch, grows by doubling
+
+typedef struct BatchRange {
+    int offset; //In vertices
+    int count;
+} BatchRange;
+
+typedef struct DrawBatch {
+    uint64_t key;
+    int bx, cy, bz;
+    unsigned int vaoId;
+    unsigned int vboId;
+    uint8_t *vertices;  //CPU copy of the whole buffer, growing re-uploads it instead of reading the GPU back
+    int capacity;       //In vertices
+    BatchRange slots[BATCH_SLOTS]; //[lz * BATCH_SIZE + lx], count 0 = no mesh
+    int slotCount;
+    BatchRange *free;   //Unused ranges sorted by offset, neighbours always merged
+    int freeCount;
+    int freeCapacity;
+    uint32_t visibleMask; //Slots queued for this frame
+    bool queued;
+    struct DrawBatch *nextQueued;
+    struct DrawBatch *chain;
+} DrawBatch;
+
+static DrawBatch *buckets[DRAW_BATCH_BUCKETS];
+static DrawBatch *queuedBatches = NULL;
+static DrawBatchStats stats = {0};
+
+static int floorDiv(int value, int divisor)
+{
+    return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+}
+
+static DrawBatch **bucketFor(uint64_t key)
+{
+    return &buckets[(key * 0x9E3779B97F4A7C15ULL) >> 56];
+}
+
+//Batch of chunk (cx, cy, cz) and the chunk's slot in it, created on demand
+static DrawBatch *findBatch(int cx, int cy, int cz, int *slot, bool create)
+{
+    int bx = floorDiv(cx, BATCH_SIZE);
+    int bz = floorDiv(cz, BATCH_SIZE);
+    *slot = (cz - bz * BATCH_SIZE) * BATCH_SIZE + (cx - bx * BATCH_SIZE);
+
+    uint64_t key = packChunkKey(bx, cy, bz);
+    DrawBatch **bucket = bucketFor(key);
+    for (DrawBatch *batch = *bucket; batch != NULL; batch = batch->chain)
+        if (batch->key == key) return batch;
+    if (!create) return NULL;
+
+    DrawBatch *batch = calloc(1, sizeof(DrawBatch));
+    batch->key = key;
+    batch->bx = bx;
+    batch->cy = cy;
+    batch->bz = bz;
+    batch->chain = *bucket;
+    *bucket = batch;
+    stats.batches++;
+    return batch;
+}
+
+static void destroyBatch(DrawBatch *batch)
+{
+    DrawBatch **link = bucketFor(batch->key);
+    while (*link != batch) link = &(*link)->chain;
+    *link = batch->chain;
+
+    if (batch->vaoId != 0)
+        unloadPackedBuffer(batch->vaoId, batch->vboId);
+    stats.bufferBytes -= (size_t)batch->capacity * PACKED_VERTEX_SIZE;
+    stats.batches--;
+    free(batch->vertices);
+    free(batch->free);
+    free(batch);
+}
+
+static void insertFreeRange(DrawBatch *batch, int at, BatchRange range)
+{
+    if (batch->freeCount == batch->freeCapacity)
+    {
+        batch->freeCapacity = batch->freeCapacity ? batch->freeCapacity * 2 : 8;
+        batch->free = realloc(batch->free, batch->freeCapacity * sizeof(BatchRange));
+    }
+    memmove(&batch->free[at + 1], &batch->free[at], (batch->freeCount - at) * sizeof(BatchRange));
+    batch->free[at] = range;
+    batch->freeCount++;
+}
+
+static void removeFreeRange(DrawBatch *batch, int at)
+{
+    batch->freeCount--;
+    memmove(&batch->free[at], &batch->free[at + 1], (batch->freeCount - at) * sizeof(BatchRange));
+}
+
+static void releaseRange(DrawBatch *batch, BatchRange range)
+{
+    if (range.count == 0) return;
+
+    int at = 0;
+    while (at < batch->freeCount && batch->free[at].offset < range.offset) at++;
+
+    bool joinsBefore = at > 0 && batch->free[at - 1].offset + batch->free[at - 1].count == range.offset;
+    bool joinsAfter = at < batch->freeCount && range.offset + range.count == batch->free[at].offset;
+    if (joinsBefore && joinsAfter)
+    {
+        batch->free[at - 1].count += range.count + batch->free[at].count;
+        removeFreeRange(batch, at);
+    }
+    else if (joinsBefore)
+        batch->free[at - 1].count += range.count;
+    else if (joinsAfter)
+    {
+        batch->free[at].offset = range.offset;
+        batch->free[at].count += range.count;
+    }
+    else
+        insertFreeRange(batch, at, range);
+}
+
+//Doubles the buffer until count more vertices fit at its end. The old buffer is dropped and the CPU copy uploaded whole
+static void growBatch(DrawBatch *batch, int count)
+{
+    int capacity = batch->capacity ? batch->capacity : BATCH_MIN_VERTICES;
+    while (capacity - batch->capacity < count) capacity *= 2;
+
+    batch->vertices = realloc(batch->vertices, (size_t)capacity * PACKED_VERTEX_SIZE);
+    memset(batch->vertices + (size_t)batch->capacity * PACKED_VERTEX_SIZE, 0, (size_t)(capacity - batch->capacity) * PACKED_VERTEX_SIZE);
+    releaseRange(batch, (BatchRange){ batch->capacity, capacity - batch->capacity });
+    stats.bufferBytes += (size_t)(capacity - batch->capacity) * PACKED_VERTEX_SIZE;
+    if (batch->vaoId != 0)
+    {
+        unloadPackedBuffer(batch->vaoId, batch->vboId);
+        stats.grows++;
+    }
+    batch->capacity = capacity;
+    loadPackedBuffer(batch->vertices, capacity, true, &batch->vaoId, &batch->vboId);
+}
+
+//First fit, the free list is short since neighbouring ranges merge
+static BatchRange allocateRange(DrawBatch *batch, int count)
+{
+    for (;;)
+    {
+        for (int i = 0; i < batch->freeCount; i++)
+        {
+            if (batch->free[i].count < count) continue;
+            BatchRange range = { batch->free[i].offset, count };
+            batch->free[i].offset += count;
+            batch->free[i].count -= count;
+            if (batch->free[i].count == 0) removeFreeRange(batch, i);
+            return range;
+        }
+        growBatch(batch, count);
+    }
+}
+
+void storeBatchedMesh(int cx, int cy, int cz, const uint8_t *vertices, int vertexCount)
+{
+    if (vertexCount <= 0)
+    {
+        removeBatchedMesh(cx, cy, cz);
+        return;
+    }
+
+    int slot;
+    DrawBatch *batch = findBatch(cx, cy, cz, &slot, true);
+    BatchRange *range = &batch->slots[slot];
+
+    //A mesh that fits where the old one was is patched in place, the leftover tail goes back to the free list
+    if (range->count >= vertexCount)
+    {
+        stats.usedBytes -= (size_t)(range->count - vertexCount) * PACKED_VERTEX_SIZE;
+        releaseRange(batch, (BatchRange){ range->offset + vertexCount, range->count - vertexCount });
+        range->count = vertexCount;
+        stats.patches++;
+    }
+    else
+    {
+        if (range->count > 0)
+        {
+            stats.usedBytes -= (size_t)range->count * PACKED_VERTEX_SIZE;
+            releaseRange(batch, *range);
+        }
+        else
+            batch->slotCount++;
+        *range = allocateRange(batch, vertexCount);
+        stats.usedBytes += (size_t)vertexCount * PACKED_VERTEX_SIZE;
+    }
+
+    //Chunk meshes are in chunk blocks, shift x and z to the batch. BATCH_SIZE * CHUNK_WIDTH must stay within a byte
+    int lx = (slot % BATCH_SIZE) * CHUNK_WIDTH;
+    int lz = (slot / BATCH_SIZE) * CHUNK_WIDTH;
+    uint8_t *dst = batch->vertices + (size_t)range->offset * PACKED_VERTEX_SIZE;
+    for (int v = 0; v < vertexCount; v++)
+    {
+        dst[v * PACKED_VERTEX_SIZE + 0] = (uint8_t)(vertices[v * PACKED_VERTEX_SIZE + 0] + lx);
+        dst[v * PACKED_VERTEX_SIZE + 1] = vertices[v * PACKED_VERTEX_SIZE + 1];
+        dst[v * PACKED_VERTEX_SIZE + 2] = (uint8_t)(vertices[v * PACKED_VERTEX_SIZE + 2] + lz);
+        dst[v * PACKED_VERTEX_SIZE + 3] = vertices[v * PACKED_VERTEX_SIZE + 3];
+    }
+
+    rlUpdateVertexBuffer(batch->vboId, dst, vertexCount * PACKED_VERTEX_SIZE, range->offset * PACKED_VERTEX_SIZE);
+}
+
+void removeBatchedMesh(int cx, int cy, int cz)
+{
+    int slot;
+    DrawBatch *batch = findBatch(cx, cy, cz, &slot, false);
+    if (batch == NULL || batch->slots[slot].count == 0) return;
+
+    stats.usedBytes -= (size_t)batch->slots[slot].count * PACKED_VERTEX_SIZE;
+    releaseRange(batch, batch->slots[slot]);
+    batch->slots[slot] = (BatchRange){0};
+    batch->visibleMask &= ~(1u << slot);
+    if (--batch->slotCount > 0) return;
+
+    if (batch->queued)
+    {
+        DrawBatch **link = &queuedBatches;
+        while (*link != batch) link = &(*link)->nextQueued;
+        *link = batch->nextQueued;
+    }
+    destroyBatch(batch);
+}
+
+void queueBatchedDraw(int cx, int cy, int cz)
+{
+    int slot;
+    DrawBatch *batch = findBatch(cx, cy, cz, &slot, false);
+    if (batch == NULL || batch->slots[slot].count == 0) return;
+
+    if (!batch->queued)
+    {
+        batch->queued = true;
+        batch->nextQueued = queuedBatches;
+        queuedBatches = batch;
+    }
+    batch->visibleMask |= 1u << slot;
+}
+
+void drawQueuedBatches(void)
+{
+    stats.drawCalls = 0;
+    stats.batchesDrawn = 0;
+
+    for (DrawBatch *batch = queuedBatches; batch != NULL; batch = batch->nextQueued)
+    {
+        //Visible ranges in buffer order, so ranges that touch go out as one draw
+        BatchRange visible[BATCH_SLOTS];
+        int count = 0;
+        for (int slot = 0; slot < BATCH_SLOTS; slot++)
+        {
+            if (!(batch->visibleMask & (1u << slot))) continue;
+            BatchRange range = batch->slots[slot];
+            int at = count++;
+            while (at > 0 && visible[at - 1].offset > range.offset)
+            {
+                visible[at] = visible[at - 1];
+                at--;
+            }
+            visible[at] = range;
+        }
+        batch->visibleMask = 0;
+        batch->queued = false;
+
+        if (count == 0) continue;
+
+        setPackedDrawPosition((Vector3){ batch->bx * BATCH_SIZE * CHUNK_WIDTH, batch->cy * CHUNK_HEIGHT, batch->bz * BATCH_SIZE * CHUNK_WIDTH });
+        rlEnableVertexArray(batch->vaoId);
+        for (int i = 0; i < count; i++)
+        {
+            BatchRange run = visible[i];
+            while (i + 1 < count && run.offset + run.count == visible[i + 1].offset)
+                run.count += visible[++i].count;
+            rlDrawVertexArray(run.offset, run.count);
+            stats.drawCalls++;
+        }
+        rlDisableVertexArray();
+        stats.batchesDrawn++;
+    }
+    queuedBatches = NULL;
+}
+
+void freeDrawBatches(void)
+{
+    for (int b = 0; b < DRAW_BATCH_BUCKETS; b++)
+        while (buckets[b] != NULL)
+            destroyBatch(buckets[b]);
+    queuedBatches = NULL;
+    stats = (DrawBatchStats){0};
+}
+
+DrawBatchStats getDrawBatchStats(void)
+{
+    return stats;
+}
@@ -0,0 +1,29 @@
+#ifndef DRAWBATCH_H
+#define DRAWBATCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+//Packed meshes of BATCH_SIZE x BATCH_SIZE chunk columns on one chunk layer share a single vertex buffer.
+//Each chunk owns a range of it, so an edit only rewrites its own range and a batch is drawn with one uniform upload.
+//Main thread only
+typedef struct DrawBatchStats {
+    int batches;
+    int drawCalls;      //Last drawQueuedBatches, one per contiguous run of visible ranges
+    int batchesDrawn;   //Last drawQueuedBatches
+    size_t bufferBytes; //Vertex buffer capacity of every batch
+    size_t usedBytes;   //Of which chunk ranges
+    long long patches;  //Meshes rewritten inside their old range
+    long long grows;    //Buffers reallocated because no free range fit
+} DrawBatchStats;
+
+//Copies vertexCount packed vertices into the batch of chunk (cx, cy, cz), replacing its previous mesh
+void storeBatchedMesh(int cx, int cy, int cz, const uint8_t *vertices, int vertexCount);
+void removeBatchedMesh(int cx, int cy, int cz);
+//Marks the chunk for the next drawQueuedBatches, between beginPackedDraw and endPackedDraw
+void queueBatchedDraw(int cx, int cy, int cz);
+void drawQueuedBatches(void);
+void freeDrawBatches(void);
+DrawBatchStats getDrawBatchStats(void);
+
+#endif
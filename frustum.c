@@ -0,0 +1,62 @@
+#include "frustum.h"
+#include "raymath.h"
+#include "rlgl.h"
+#include <math.h>
+
+static Vector4 normalizePlane(float a, float b, float c, float d)
+{
+    float length = sqrtf(a*a + b*b + c*c);
+    return (Vector4){ a / length, b / length, c / length, d / length };
+}
+
+Frustum frustumFromMatrix(Matrix m)
+{
+    //Gribb/Hartmann: clip = M * p, and a point is inside when -w <= x, y, z <= w.
+    //Each plane is row 3 plus or minus one of the other rows
+    Frustum frustum;
+    frustum.planes[0] = normalizePlane(m.m3 + m.m0, m.m7 + m.m4, m.m11 + m.m8,  m.m15 + m.m12); //left
+    frustum.planes[1] = normalizePlane(m.m3 - m.m0, m.m7 - m.m4, m.m11 - m.m8,  m.m15 - m.m12); //right
+    frustum.planes[2] = normalizePlane(m.m3 + m.m1, m.m7 + m.m5, m.m11 + m.m9,  m.m15 + m.m13); //bottom
+    frustum.planes[3] = normalizePlane(m.m3 - m.m1, m.m7 - m.m5, m.m11 - m.m9,  m.m15 - m.m13); //top
+    frustum.planes[4] = normalizePlane(m.m3 + m.m2, m.m7 + m.m6, m.m11 + m.m10, m.m15 + m.m14); //near
+    frustum.planes[5] = normalizePlane(m.m3 - m.m2, m.m7 - m.m6, m.m11 - m.m10, m.m15 - m.m14); //far
+    return frustum;
+}
+
+Matrix cameraViewProjection(Camera3D camera, float aspect)
+{
+    Matrix view = MatrixLookAt(camera.position, camera.target, camera.up);
+    Matrix projection = MatrixPerspective(camera.fovy * DEG2RAD, aspect, RL_CULL_DISTANCE_NEAR, RL_CULL_DISTANCE_FAR);
+    return MatrixMultiply(view, projection);
+}
+
+Frustum frustumFromCamera(Camera3D camera, float aspect)
+{
+    return frustumFromMatrix(cameraViewProjection(camera, aspect));
+}
+
+bool frustumContainsBox(const Frustum *frustum, BoundingBox box)
+{
+    for (int p = 0; p < 6; p++)
+    {
+        //Only the corner furthest along the plane normal needs checking
+        const Vector4 *plane = &frustum->planes[p];
+        float x = (plane->x >= 0.0f) ? box.max.x : box.min.x;
+        float y = (plane->y >= 0.0f) ? box.max.y : box.min.y;
+        float z = (plane->z >= 0.0f) ? box.max.z : box.min.z;
+        if (plane->x * x + plane->y * y + plane->z * z + plane->w < 0.0f)
+            return false;
+    }
+    return true;
+}
+
+bool frustumContainsPoint(const Frustum *frustum, Vector3 point)
+{
+    for (int p = 0; p < 6; p++)
+    {
+        const Vector4 *plane = &frustum->planes[p];
+        if (plane->x * point.x + plane->y * point.y + plane->z * point.z + plane->w < 0.0f)
+            return false;
+    }
+    return true;
+}
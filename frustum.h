@@ -0,0 +1,22 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include "raylib.h"
+#include <stdbool.h>
+
+//Six planes (a, b, c, d) facing inwards: a point p is inside a plane when a*p.x + b*p.y + c*p.z + d >= 0.
+//Pure math, no GL state, so it works in the headless benchmarks too
+typedef struct Frustum {
+    Vector4 planes[6]; //left, right, bottom, top, near, far
+} Frustum;
+
+//Planes of the clip volume of a combined view * projection matrix (raymath multiply order)
+Frustum frustumFromMatrix(Matrix viewProjection);
+//View * projection of a perspective camera, the same matrices raylib's BeginMode3D sets up
+Matrix cameraViewProjection(Camera3D camera, float aspect);
+Frustum frustumFromCamera(Camera3D camera, float aspect);
+//Conservative: may keep a box that is just outside near a corner, never drops one that is inside
+bool frustumContainsBox(const Frustum *frustum, BoundingBox box);
+bool frustumContainsPoint(const Frustum *frustum, Vector3 point);
+
+#endif
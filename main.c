@@ -2,112 +2,96 @@
 #include <stdlib.h>
 #include <math.h>
 #include "config.h"
+#include "bench.h"
 #include "chunk.h"
 #include "mesh.h"
 #include "character.h"
+#include "meshjobs.h"
+#include "frustum.h"
+#include "visibility.h"
+#include "region.h"
+#include "meshcache.h"
+#include "drawbatch.h"
+#include "renderdistance.h"
+#include "raycast.h"
 
-//TODO: One of the shaders is doing something by pixel as fps drops significantly when resolution increases. Need to get rid of
 //TODO: Move this somewhere it makes sense
 static Vector3 lastPlayerChunkPos = {0,0,0};
 static Shader fogShader = {0};
 static int fogDensityLoc = 0;
 static float fogDensity = FOG_VALUE;
+static int fogQuality = FOG_QUALITY;
+static const char *fogQualityNames[] = { "off", "per vertex", "per fragment" };
+static int drawnChunks = 0;
+static int culledChunks = 0;
+static int occludedChunks = 0;
+static int drawCalls = 0;
+static double drawSubmitSeconds = 0.0; //CPU time spent walking and submitting the chunks
+static int pixelSize = RENDER_PIXEL_SIZE;
 
 //TODO: Move this somewhere that makes sense. probably a player action file with setblock and getblock
 bool raycastVoxel(Camera camera, float maxDistance, Vector3 *outBlock, BlockFace *outFace)
 {
-    //TODO: Cleanup the logic here
     Vector2 screenCenter = (Vector2){ (float)SCREEN_WIDTH*0.5f, (float)SCREEN_HEIGHT*0.5f };
     Ray ray = GetMouseRay(screenCenter, camera);
-    Vector3 dir = ray.direction;
 
-    int x = (int)floor(ray.position.x);
-    int y = (int)floor(ray.position.y);
-    int z = (int)floor(ray.position.z);
-
-    if(getBlockAtWorld(x, y, z)){
-        *outBlock = (Vector3){(float)x, (float)y, (float)z};
-        return true;
-    }
-
-    int stepX = (dir.x > 0.f) ? 1 : -1;
-    int stepY = (dir.y > 0.f) ? 1 : -1;
-    int stepZ = (dir.z > 0.f) ? 1 : -1;
-
-    float tDeltaX = (dir.x == 0.f) ? INFINITY : fabs(1.f / dir.x);
-    float tDeltaY = (dir.y == 0.f) ? INFINITY : fabs(1.f / dir.y);
-    float tDeltaZ = (dir.z == 0.f) ? INFINITY : fabs(1.f / dir.z);
-
-    float rx = ray.position.x, ry = ray.position.y, rz = ray.position.z;
-    float tMaxX = (dir.x > 0.f) ? ((x + 1.0f) - rx) * tDeltaX : (rx - (float)x) * tDeltaX;
-    float tMaxY = (dir.y > 0.f) ? ((y + 1.0f) - ry) * tDeltaY : (ry - (float)y) * tDeltaY;
-    float tMaxZ = (dir.z > 0.f) ? ((z + 1.0f) - rz) * tDeltaZ : (rz - (float)z) * tDeltaZ;
-
-    float t = 0.0f;
-    while (t <= maxDistance) {
-        // Step to next voxel
-        if (tMaxX < tMaxY) {
-            if (tMaxX < tMaxZ) {
-                x += stepX;
-                t = tMaxX;
-                tMaxX += tDeltaX;
-                if (getBlockAtWorld(x, y, z)) {
-                    *outBlock = (Vector3){x, y, z};
-                    *outFace = (stepX > 0) ? FACE_NEG_X : FACE_POS_X;
-                    return true;
-                } 
-            }
-            else 
-            {
-                z += stepZ;
-                t = tMaxZ;
-                tMaxZ += tDeltaZ;
-                if (getBlockAtWorld(x, y, z)) {
-                    *outBlock = (Vector3){x, y, z};
-                    *outFace = (stepZ > 0) ? FACE_NEG_Z : FACE_POS_Z;
-                    return true;
-                }
-            }
-        }
-        else 
-        {
-            if (tMaxY < tMaxZ) {
-                y += stepY;
-                t = tMaxY;
-                tMaxY += tDeltaY;
-                if (getBlockAtWorld(x, y, z)) {
-                    *outBlock = (Vector3){x, y, z};
-                    *outFace = (stepY > 0) ? FACE_NEG_Y : FACE_POS_Y;
-                    return true;
-                }
-            } 
-            else {
-                z += stepZ;
-                t = tMaxZ;
-                tMaxZ += tDeltaZ;
-                if (getBlockAtWorld(x, y, z)) {
-                    *outBlock = (Vector3){x, y, z};
-                    *outFace = (stepZ > 0) ? FACE_NEG_Z : FACE_POS_Z;
-                    return true;
-                }
-            }
-        }
-    }
-    return false;
+    VoxelHit hit;
+    if (!castVoxelRay(ray.position, ray.direction, maxDistance, &hit)) return false;
+    *outBlock = (Vector3){ (float)hit.x, (float)hit.y, (float)hit.z };
+    *outFace = hit.face;
+    return true;
 }
 
 void drawUI(Vector3 highlightedBlock, Vector3 playerChunkLocation)
 {
     DrawText("+", SCREEN_WIDTH/2, SCREEN_HEIGHT/2, 40, CROSSHAIR_COLOR);
     DrawText(TextFormat("%d", GetFPS()), 10, 10, 30, CROSSHAIR_COLOR);
-    DrawText(TextFormat("Highlighted Block X: %d Y: %d Z: %d", (int)player.position.x, (int)player.position.y, (int)player.position.z), 10, 50, 20, CROSSHAIR_COLOR);
+    DrawText(TextFormat("3D at %dx%d, 1/%d scale (- and =), fog %s", (SCREEN_WIDTH + pixelSize - 1) / pixelSize, (SCREEN_HEIGHT + pixelSize - 1) / pixelSize, pixelSize,
+        fogQualityNames[fogQuality]), 100, 15, 20, CROSSHAIR_COLOR);
+    DrawText(TextFormat("Highlighted Block X: %d Y: %d Z: %d", (int)player.body.position.x, (int)player.body.position.y, (int)player.body.position.z), 10, 50, 20, CROSSHAIR_COLOR);
+    MeshMemoryStats meshStats = getMeshMemoryStats();
+    float perChunkKB = meshStats.residentMeshes ? meshStats.residentBytes / 1024.0f / meshStats.residentMeshes : 0.0f;
+    DrawText(TextFormat("Mesh heap: %d chunks, %.1f KB/chunk, peak build %.1f KB, %d skipped", meshStats.residentMeshes, perChunkKB, meshStats.peakBuildBytes / 1024.0f, meshStats.skippedMeshes), 10, 75, 20, CROSSHAIR_COLOR);
+    DrawText(TextFormat("Chunks drawn: %d culled: %d occluded: %d resident: %d", drawnChunks, culledChunks, occludedChunks, getResidentChunkCount()), 10, 100, 20, CROSSHAIR_COLOR);
+    MeshCacheStats cacheStats = getMeshCacheStats();
+    float hitRate = cacheStats.lookups ? 100.0f * (cacheStats.hits + cacheStats.spillHits) / cacheStats.lookups : 0.0f;
+    DrawText(TextFormat("Mesh cache: %.0f%% hits, %d meshes, %.1f MB", hitRate, cacheStats.entries, cacheStats.bytes / (1024.0f * 1024.0f)), 10, 125, 20, CROSSHAIR_COLOR);
+    for (int lod = 0; lod < LOD_LEVELS; lod++)
+    {
+        const MeshLodStats *ring = &meshStats.lod[lod];
+        DrawText(TextFormat("LOD %dx: %d chunks, %lldk tris, %.2f ms/build", 1 << lod, ring->meshes, ring->triangles / 1000, ring->buildMs),
+            10 + lod * 390, 150, 20, CROSSHAIR_COLOR);
+    }
+#if CHUNK_PACKED_VERTICES && CHUNK_BATCHING
+    DrawBatchStats batchStats = getDrawBatchStats();
+    DrawText(TextFormat("Draw calls: %d (%d batches of %d), submit %.2f ms, batch buffers %.1f/%.1f MB", drawCalls, batchStats.batchesDrawn, batchStats.batches,
+        drawSubmitSeconds * 1000.0, batchStats.usedBytes / (1024.0f * 1024.0f), batchStats.bufferBytes / (1024.0f * 1024.0f)), 10, 175, 20, CROSSHAIR_COLOR);
+#else
+    DrawText(TextFormat("Draw calls: %d, submit %.2f ms", drawCalls, drawSubmitSeconds * 1000.0), 10, 175, 20, CROSSHAIR_COLOR);
+#endif
+    RenderDistanceStats distanceStats = getRenderDistanceStats();
+    DrawText(TextFormat("Render distance %d, LOD radius %d, %.2f ms/frame for a %.2f ms budget%s", distanceStats.renderDistance, distanceStats.lodRadius,
+        distanceStats.averageMs, FRAME_BUDGET_MS, ADAPTIVE_RENDER_DISTANCE ? "" : " (fixed)"), 10, 200, 20, CROSSHAIR_COLOR);
+}
+
+static void loadWorldShader(void)
+{
+    //Packed chunk vertices need the decoding vertex shader, the fragment side is shared
+    fogShader = loadFogShader(CHUNK_PACKED_VERTICES ? "shader/chunk.vs" : "shader/fog.vs", fogQuality);
+    fogDensityLoc = GetShaderLocation(fogShader, "fogDensity");
+    SetShaderValue(fogShader, fogDensityLoc, &fogDensity, SHADER_UNIFORM_FLOAT);
 }
 
-int main(void) 
+int main(int argc, char **argv) 
 {
+    //Headless benchmarks run instead of the game
+    if (argc > 1)
+        return runBenchmark(argv[1]) ? 0 : 1;
+
     //Main Window Handling
     InitWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Carson's Game");
-    RenderTexture2D target = LoadRenderTexture(SCREEN_WIDTH, SCREEN_HEIGHT);
+    //The world is drawn small and scaled up, fragment and fog work shrink with the square of the pixel size
+    RenderTexture2D target = loadSceneTarget(pixelSize);
     SetTargetFPS(TARGET_FPS);    
     DisableCursor();
     
@@ -119,16 +103,11 @@ int main(void)
     EndDrawing();
 
     
-    //Map Memory and then init chunk data
-    allocateChunks(WORLD_SIZE_CHUNKS);
+    //Map Memory, chunk data is generated on demand as chunks come into range
     initChunks();
 
     //Shader Setup
-    fogShader = LoadShader("shader/fog.vs", "shader/fog.fs");
-    fogShader.locs[SHADER_LOC_VECTOR_VIEW] = GetShaderLocation(fogShader, "viewPos");
-    fogShader.locs[SHADER_LOC_MATRIX_MODEL] = GetShaderLocation(fogShader, "matModel");
-    fogDensityLoc = GetShaderLocation(fogShader, "fogDensity");
-    SetShaderValue(fogShader, fogDensityLoc, &fogDensity, SHADER_UNIFORM_FLOAT);
+    loadWorldShader();
 
     //Camera Setup
     Camera3D camera = {0};
@@ -136,26 +115,24 @@ int main(void)
     camera.up = (Vector3){ 0.0f, 1.0f, 0.0f }; //up-vector (rotation towards target) idrk what this means
     camera.fovy = CAMERA_FOV;
     camera.projection = CAMERA_PERSPECTIVE;
-    spawnPlayer((Vector3){(WORLD_SIZE_CHUNKS * CHUNK_WIDTH)/2, (float)CHUNK_HEIGHT + 500, (WORLD_SIZE_CHUNKS * CHUNK_WIDTH)/2});
-
-    Shader pxShader = LoadShader(0, "shader/pixelizer.fs");
-    int resolutionLoc = GetShaderLocation(pxShader, "resolution");
-    int pixelSizeLoc = GetShaderLocation(pxShader, "pixelSize");
-
-    float resolution[2] = { (float)GetScreenWidth(), (float)GetScreenHeight() };
-    SetShaderValue(pxShader, resolutionLoc, resolution, SHADER_UNIFORM_VEC2);
-
-    float pixelSize = 5.0f; //bigger = more pixelated
-    SetShaderValue(pxShader, pixelSizeLoc, &pixelSize, SHADER_UNIFORM_FLOAT);
+    spawnPlayer((Vector3){SPAWN_CHUNK * CHUNK_WIDTH, (float)WORLD_HEIGHT + 500, SPAWN_CHUNK * CHUNK_WIDTH});
 
     //TODO make sure these are ok to be here, do I need to alloc, what ever
     Vector3 highlighted = {0.0f,0.0f,0.0f}; //What the players looking at
     bool casting = false;
     BlockFace placeFace;
 
+    initMeshJobs(MESH_WORKER_THREADS);
+    initRegions(WORLD_DIRECTORY);
+    double lastSave = GetTime();
+    initRenderDistance();
     Vector3 playerChunkPos = getPlayerChunkPos(camera);
-    updateVisibleChunks(playerChunkPos, fogShader);
+    updateVisibleChunks(playerChunkPos);
     lastPlayerChunkPos = playerChunkPos;
+    //The first square is loaded while the loading screen is up, after that loads are spread over frames
+    while (getQueuedChunkLoads() > 0)
+        processChunkQueues(CHUNK_LOADS_PER_FRAME, 0);
+    printChunkMemoryReport();
 
     while(!WindowShouldClose())
     {
@@ -167,16 +144,49 @@ int main(void)
         playerChunkPos = getPlayerChunkPos(camera);
         if (playerChunkPos.x != lastPlayerChunkPos.x || playerChunkPos.z != lastPlayerChunkPos.z)
         {
-            updateVisibleChunks(playerChunkPos, fogShader);
+            updateVisibleChunks(playerChunkPos);
             lastPlayerChunkPos = playerChunkPos;
         }
+#if ADAPTIVE_RENDER_DISTANCE
+        //A new distance or LOD radius reshapes the square around the same column
+        if (updateRenderDistance(dt, getQueuedChunkLoads() + getPendingMeshJobs()))
+            updateVisibleChunks(playerChunkPos);
+#endif
+        processChunkQueues(CHUNK_LOADS_PER_FRAME, CHUNK_UNLOADS_PER_FRAME);
+        processMeshUploads(fogShader);
+        if (GetTime() - lastSave > WORLD_AUTOSAVE_SECONDS)
+        {
+            saveModifiedChunks();
+            lastSave = GetTime();
+        }
 
         casting = raycastVoxel(camera, MAX_REACH, &highlighted, &placeFace);
         
         if(IsMouseButtonPressed(MOUSE_LEFT_BUTTON) && casting)
-            setBlockAtWorld((int)highlighted.x, (int)highlighted.y, (int)highlighted.z, 0, FACE_NONE, fogShader);
+            setBlockAtWorld((int)highlighted.x, (int)highlighted.y, (int)highlighted.z, 0, FACE_NONE);
         if(IsMouseButtonPressed(MOUSE_RIGHT_BUTTON) && casting)
-            setBlockAtWorld((int)highlighted.x, (int)highlighted.y, (int)highlighted.z, 1, placeFace, fogShader);
+            setBlockAtWorld((int)highlighted.x, (int)highlighted.y, (int)highlighted.z, 1, placeFace);
+        //Everything edited this frame is rebuilt once
+        flushDirtyChunks();
+
+        int newPixelSize = pixelSize;
+        if (IsKeyPressed(KEY_MINUS) && pixelSize > 1) newPixelSize--;
+        if (IsKeyPressed(KEY_EQUAL) && pixelSize < RENDER_PIXEL_SIZE_MAX) newPixelSize++;
+        if (newPixelSize != pixelSize)
+        {
+            UnloadRenderTexture(target);
+            pixelSize = newPixelSize;
+            target = loadSceneTarget(pixelSize);
+        }
+#if CHUNK_PACKED_VERTICES
+        //Float models keep the shader in their materials, only packed drawing can swap it live
+        if (IsKeyPressed(KEY_F))
+        {
+            UnloadShader(fogShader);
+            fogQuality = (fogQuality + 1) % 3;
+            loadWorldShader();
+        }
+#endif
         SetShaderValue(fogShader, fogShader.locs[SHADER_LOC_VECTOR_VIEW], &camera.position.x, SHADER_UNIFORM_VEC3);
         BeginTextureMode(target);
             ClearBackground(SKY_COLOR);
@@ -184,19 +194,69 @@ int main(void)
                 // Only render chunks within render distance
                 int pcx = (int)playerChunkPos.x;
                 int pcz = (int)playerChunkPos.z;
-                
+                Frustum frustum = frustumFromCamera(camera, (float)SCREEN_WIDTH / SCREEN_HEIGHT);
+                unsigned int visibleStamp = findVisibleChunks(camera.position, currentRenderDistance);
+                drawnChunks = 0;
+                culledChunks = 0;
+                occludedChunks = 0;
+                double submitStart = GetTime();
+
+#if CHUNK_PACKED_VERTICES
+                beginPackedDraw(fogShader, GRAY);
+#endif
                 for(int cx = pcx - currentRenderDistance; cx <= pcx + currentRenderDistance; cx++)
                 {
                     for(int cz = pcz - currentRenderDistance; cz <= pcz + currentRenderDistance; cz++)
                     {
-                        if (cx < 0 || cx >= WORLD_SIZE_CHUNKS) continue;
-                        if (cz < 0 || cz >= WORLD_SIZE_CHUNKS) continue;
-                        
-                        //Only draw if mesh exists
-                        if (chunks[cx][0][cz].mesh.vertexCount > 0)
-                            DrawModel(chunks[cx][0][cz].model, (Vector3){cx * CHUNK_WIDTH, 0, cz * CHUNK_WIDTH}, 1.0f, GRAY);
+                        for(int cy = 0; cy < WORLD_HEIGHT_CHUNKS; cy++)
+                        {
+                            Chunk *chunk = findChunk(cx, cy, cz);
+                            if (chunk == NULL) continue;
+
+                            //Only draw if mesh exists
+#if CHUNK_PACKED_VERTICES
+                            if (chunk->packed.vertexCount == 0) continue;
+#else
+                            if (chunk->model.meshCount == 0) continue;
+#endif
+                            //and there is an open path to it
+                            if (chunk->visibleStamp != visibleStamp)
+                            {
+                                occludedChunks++;
+                                continue;
+                            }
+                            //and some of it is in view
+                            if (!frustumContainsBox(&frustum, getChunkBounds(chunk)))
+                            {
+                                culledChunks++;
+                                continue;
+                            }
+                            drawnChunks++;
+
+#if CHUNK_PACKED_VERTICES && CHUNK_BATCHING
+                            //Drawn a batch at a time after the walk
+                            queueBatchedDraw(cx, cy, cz);
+#else
+                            Vector3 chunkPos = (Vector3){cx * CHUNK_WIDTH, cy * CHUNK_HEIGHT, cz * CHUNK_WIDTH};
+#if CHUNK_PACKED_VERTICES
+                            drawPackedMesh(&chunk->packed, chunkPos);
+#else
+                            DrawModel(chunk->model, chunkPos, 1.0f, GRAY);
+#endif
+#endif
+                        }
                     }
-                }                
+                }
+#if CHUNK_PACKED_VERTICES && CHUNK_BATCHING
+                drawQueuedBatches();
+                drawCalls = getDrawBatchStats().drawCalls;
+#else
+                drawCalls = drawnChunks;
+#endif
+#if CHUNK_PACKED_VERTICES
+                endPackedDraw();
+#endif
+                drawSubmitSeconds = GetTime() - submitStart;
                 if(casting) {
                     for (int s = 0; s < 4; s++) 
                     {
@@ -208,15 +268,16 @@ int main(void)
         EndTextureMode();
         
         BeginDrawing();
-            BeginShaderMode(pxShader);
-                DrawTextureRec(target.texture, (Rectangle){ 0, 0, (float)target.texture.width, -(float)target.texture.height }, (Vector2){ 0, 0 }, WHITE);
-            EndShaderMode();
+            drawSceneTarget(target, pixelSize);
             drawUI(highlighted, playerChunkPos);
         EndDrawing();
     }
-    UnloadShader(pxShader);
     UnloadRenderTexture(target);
-    freeChunks(WORLD_SIZE_CHUNKS);
+    shutdownMeshJobs();
+    saveModifiedChunks();
+    shutdownRegions();
+    freeChunks();
+    freeDrawBatches();
     UnloadShader(fogShader);
     CloseWindow();
     return 0;
@@ -1 +1 @@
-gcc -o main.exe *.c -IC:/raylib/raylib/build/raylib/include -LC:/raylib/raylib/build/raylib -lraylib -lopengl32 -lgdi32 -lwinmm -lkernel32
\ No newline at end of file
+gcc -o main.exe *.c -IC:/raylib/raylib/build/raylib/include -LC:/raylib/raylib/build/raylib -lraylib -lopengl32 -lgdi32 -lwinmm -lkernel32 -lpthread
\ No newline at end of file
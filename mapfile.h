@@ -0,0 +1,23 @@
+#ifndef MAPFILE_H
+#define MAPFILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+//Read only view of a whole file. Kept apart from raylib since windows.h clashes with raylib.h
+typedef struct MappedFile {
+    const uint8_t *data;
+    size_t size;
+    void *handle;   //Win32 file and mapping handles, unused on POSIX
+    void *mapping;
+} MappedFile;
+
+//False if the file is missing or empty
+bool mapFile(MappedFile *file, const char *path);
+void unmapFile(MappedFile *file);
+//True if the directory exists afterwards
+bool makeDirectory(const char *path);
+bool removeDirectory(const char *path);
+
+#endif
@@ -2,39 +2,241 @@
 #include <math.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
 
 static const Vector3 faceNormals[6] = {
     {0,0,1}, {0,0,-1}, {1,0,0}, {-1,0,0}, {0,1,0}, {0,-1,0}
 };
 
-Mesh generateChunkMesh(struct Chunk ***chunks, int cx, int cy, int cz)
+void snapshotChunk(ChunkSnapshot *snapshot, int cx, int cy, int cz)
 {
-    Mesh mesh = {0};
+    snapshot->cx = cx;
+    snapshot->cy = cy;
+    snapshot->cz = cz;
+    //Anything not covered by a neighbour (unloaded, above the world, diagonals) stays air.
+    //Below the world counts as solid so the bottom layer has no floor faces
+    memset(snapshot->blocks, AIR, sizeof(snapshot->blocks));
+    if (cy == 0)
+        for (int x = 0; x < CHUNK_WIDTH; x++)
+            for (int z = 0; z < CHUNK_WIDTH; z++)
+                snapshot->blocks[x + 1][0][z + 1] = SOLID;
 
-    int totalBlocks = CHUNK_WIDTH * CHUNK_HEIGHT * CHUNK_WIDTH;
-    mesh.vertexCount = totalBlocks * 6 * 4;    //TODO: Both worst case, can probably be reduced somehow so look into that but idk rn.
-    mesh.triangleCount = totalBlocks * 6 * 2; 
-    mesh.vertices = MemAlloc(mesh.vertexCount * 3 * sizeof(float));
-    mesh.normals = MemAlloc(mesh.vertexCount * 3 * sizeof(float));
-    mesh.texcoords = MemAlloc(mesh.vertexCount * 2 * sizeof(float));
-    mesh.indices = MemAlloc(mesh.triangleCount * 3 * sizeof(unsigned short));
+    const Chunk *chunk = getChunk(cx, cy, cz);
+    uint8_t raw[SECTION_VOLUME];
+    for (int s = 0; s < CHUNK_SECTIONS; s++)
+    {
+        unpackSection(&chunk->sections[s], raw);
+        for (int x = 0; x < CHUNK_WIDTH; x++)
+            for (int y = 0; y < SECTION_HEIGHT; y++)
+                for (int z = 0; z < CHUNK_WIDTH; z++)
+                    snapshot->blocks[x + 1][s * SECTION_HEIGHT + y + 1][z + 1] = raw[SECTION_INDEX(x, y, z)];
+    }
+
+    //Border slices of the face neighbours
+    const Chunk *n;
+    if ((n = getChunk(cx - 1, cy, cz)) != NULL)
+        for (int y = 0; y < CHUNK_HEIGHT; y++)
+            for (int z = 0; z < CHUNK_WIDTH; z++)
+                snapshot->blocks[0][y + 1][z + 1] = (uint8_t)getChunkBlock(n, CHUNK_WIDTH - 1, y, z);
+    if ((n = getChunk(cx + 1, cy, cz)) != NULL)
+        for (int y = 0; y < CHUNK_HEIGHT; y++)
+            for (int z = 0; z < CHUNK_WIDTH; z++)
+                snapshot->blocks[CHUNK_WIDTH + 1][y + 1][z + 1] = (uint8_t)getChunkBlock(n, 0, y, z);
+    if ((n = getChunk(cx, cy, cz - 1)) != NULL)
+        for (int x = 0; x < CHUNK_WIDTH; x++)
+            for (int y = 0; y < CHUNK_HEIGHT; y++)
+                snapshot->blocks[x + 1][y + 1][0] = (uint8_t)getChunkBlock(n, x, y, CHUNK_WIDTH - 1);
+    if ((n = getChunk(cx, cy, cz + 1)) != NULL)
+        for (int x = 0; x < CHUNK_WIDTH; x++)
+            for (int y = 0; y < CHUNK_HEIGHT; y++)
+                snapshot->blocks[x + 1][y + 1][CHUNK_WIDTH + 1] = (uint8_t)getChunkBlock(n, x, y, 0);
+    if ((n = getChunk(cx, cy - 1, cz)) != NULL)
+        for (int x = 0; x < CHUNK_WIDTH; x++)
+            for (int z = 0; z < CHUNK_WIDTH; z++)
+                snapshot->blocks[x + 1][0][z + 1] = (uint8_t)getChunkBlock(n, x, CHUNK_HEIGHT - 1, z);
+    if ((n = getChunk(cx, cy + 1, cz)) != NULL)
+        for (int x = 0; x < CHUNK_WIDTH; x++)
+            for (int z = 0; z < CHUNK_WIDTH; z++)
+                snapshot->blocks[x + 1][CHUNK_HEIGHT + 1][z + 1] = (uint8_t)getChunkBlock(n, x, 0, z);
+}
+
+uint64_t hashSnapshot(const ChunkSnapshot *snapshot)
+{
+    //Eight blocks per step, multiply and fold. The array is a multiple of 8 bytes
+    const uint8_t *bytes = &snapshot->blocks[0][0][0];
+    uint64_t hash = 0x9E3779B97F4A7C15ULL;
+    for (size_t i = 0; i < sizeof(snapshot->blocks); i += 8)
+    {
+        uint64_t word;
+        memcpy(&word, bytes + i, 8);
+        hash = (hash ^ word) * 0xFF51AFD7ED558CCDULL;
+        hash ^= hash >> 32;
+    }
+    return hash;
+}
+
+static bool rowOccupied(const ChunkSnapshot *snapshot, int y)
+{
+    for (int x = 1; x <= CHUNK_WIDTH; x++)
+        for (int z = 1; z <= CHUNK_WIDTH; z++)
+            if (snapshot->blocks[x][y + 1][z] != AIR) return true;
+    return false;
+}
+
+bool snapshotOccupiedRows(const ChunkSnapshot *snapshot, int *minY, int *maxY)
+{
+    int low = 0;
+    while (low < CHUNK_HEIGHT && !rowOccupied(snapshot, low)) low++;
+    if (low == CHUNK_HEIGHT) return false;
+
+    int high = CHUNK_HEIGHT - 1;
+    while (!rowOccupied(snapshot, high)) high--;
+    *minY = low;
+    *maxY = high;
+    return true;
+}
+
+static atomic_size_t peakBuildBytes = 0;
+static pthread_once_t scratchOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t scratchKey;
+
+static void freeScratch(void *data)
+{
+    QuadList *scratch = data;
+    free(scratch->quads);
+    free(scratch);
+}
+
+static void createScratchKey(void)
+{
+    pthread_key_create(&scratchKey, freeScratch);
+}
+
+//Each meshing thread keeps one quad list that grows to its largest chunk and is freed when the thread exits
+static QuadList *getScratchQuads(void)
+{
+    pthread_once(&scratchOnce, createScratchKey);
+    QuadList *scratch = pthread_getspecific(scratchKey);
+    if (scratch == NULL)
+    {
+        scratch = calloc(1, sizeof(QuadList));
+        pthread_setspecific(scratchKey, scratch);
+    }
+    return scratch;
+}
+
+void pushQuad(QuadList *list, int face, int x, int y, int z, int width, int height)
+{
+    if (list->count == list->capacity)
+    {
+        list->capacity = list->capacity ? list->capacity * 2 : 1024;
+        list->quads = realloc(list->quads, list->capacity * sizeof(MeshQuad));
+    }
+    list->quads[list->count++] = (MeshQuad){ (uint8_t)face, (uint8_t)x, (uint8_t)y, (uint8_t)z, (uint8_t)width, (uint8_t)height };
+}
+
+size_t meshDataBytes(const Mesh *mesh)
+{
+    //positions + normals + texcoords, colors, indices
+    return (size_t)mesh->vertexCount * (3 + 3 + 2) * sizeof(float)
+         + (size_t)mesh->vertexCount * 4
+         + (size_t)mesh->triangleCount * 3 * sizeof(unsigned short);
+}
+
+size_t packedMeshBytes(const PackedMesh *mesh)
+{
+    return (size_t)mesh->vertexCount * PACKED_VERTEX_SIZE;
+}
+
+size_t modelDataBytes(const Model *model)
+{
+    size_t bytes = 0;
+    for (int m = 0; m < model->meshCount; m++)
+        bytes += meshDataBytes(&model->meshes[m]);
+    return bytes;
+}
+
+size_t getPeakMeshBuildBytes(void)
+{
+    return atomic_load(&peakBuildBytes);
+}
 
+static void recordBuildBytes(const QuadList *scratch, size_t meshBytes)
+{
+    //Peak while building is the scratch list plus the finished arrays
+    size_t buildBytes = scratch->capacity * sizeof(MeshQuad) + meshBytes;
+    size_t peak = atomic_load(&peakBuildBytes);
+    while (buildBytes > peak && !atomic_compare_exchange_weak(&peakBuildBytes, &peak, buildBytes));
+}
 
-    int v = 0;
-    int idx = 0;
+//Count then fill: quads land in a per-thread scratch list that is reused between chunks,
+//so the mesh arrays can be allocated at their exact size
+static QuadList *collectChunkQuads(const ChunkSnapshot *snapshot, int lod)
+{
+    QuadList *scratch = getScratchQuads();
+    scratch->count = 0;
 
+    //Reduced levels always go through the bitmask mesher, their quads are in cells of 1 << lod blocks
+    if (lod > 0)
+    {
+        lodGreedyMesh(scratch, snapshot, lod);
+        return scratch;
+    }
+#if MESHER_BINARY
+    binaryGreedyMesh(scratch, snapshot);
+#else
     for(int face = 0; face < 6; face++)
-        greedyMesh(&mesh, chunks, &v, &idx, face, cx, cy, cz);
-    
+        greedyMesh(scratch, snapshot, face);
+#endif
+    return scratch;
+}
+
+PackedMesh generatePackedChunkMesh(const ChunkSnapshot *snapshot)
+{
+    return generatePackedLodMesh(snapshot, 0);
+}
+
+PackedMesh generatePackedLodMesh(const ChunkSnapshot *snapshot, int lod)
+{
+    QuadList *scratch = collectChunkQuads(snapshot, lod);
+    int scale = 1 << lod;
+
+    PackedMesh mesh = {0};
+    if (scratch->count == 0) return mesh;
+
+    //No index buffer: two triangles written out per quad, so there is no 16 bit index to overflow
+    //and the 2 index bytes per vertex cost more than the 4 byte vertices they would dedupe
+    static const int quadOrder[PACKED_VERTICES_PER_QUAD] = { 0, 1, 2, 2, 1, 3 };
+    mesh.vertexCount = scratch->count * PACKED_VERTICES_PER_QUAD;
+    mesh.vertices = MemAlloc(mesh.vertexCount * PACKED_VERTEX_SIZE);
+
+    //x, y, z and the face index, one byte each. Normals, UVs and lighting are rebuilt in shader/chunk.vs
+    for (int q = 0; q < scratch->count; q++)
+    {
+        const MeshQuad *quad = &scratch->quads[q];
+        Vector3 corners[4];
+        Vector2 uvs[4];
+        faceCorners(quad->face, quad->width, quad->height, corners, uvs);
+
+        for (int c = 0; c < PACKED_VERTICES_PER_QUAD; c++)
+        {
+            const Vector3 *corner = &corners[quadOrder[c]];
+            uint8_t *vertex = &mesh.vertices[(q * PACKED_VERTICES_PER_QUAD + c) * PACKED_VERTEX_SIZE];
+            vertex[0] = (uint8_t)((quad->x + (int)corner->x) * scale);
+            vertex[1] = (uint8_t)((quad->y + (int)corner->y) * scale);
+            vertex[2] = (uint8_t)((quad->z + (int)corner->z) * scale);
+            vertex[3] = quad->face;
+        }
+    }
 
-    // Update counts based on what we actually wrote
-    mesh.vertexCount = v;
-    mesh.triangleCount = idx / 3;
-    //Shader Allocation
-    mesh.animVertices = MemAlloc(mesh.vertexCount * 3 * sizeof(float));
-    for (int vi = 0; vi < mesh.vertexCount * 3; vi++)
-        mesh.animVertices[vi] = mesh.vertices[vi];
+    recordBuildBytes(scratch, packedMeshBytes(&mesh));
+    return mesh;
+}
 
+static void bakeLighting(Mesh *mesh)
+{
 //TODO: simple lighting, kinda of like it but can explore more later
 //choose light direction and ambient
 Vector3 lightDir = (Vector3){ -1.0f, -1.0f, -0.6f };
@@ -43,28 +245,76 @@ lightDir.x /= llen; lightDir.y /= llen; lightDir.z /= llen;
 float ambient = 0.25f;
 
 //allocate colors (4 bytes per vertex)
-mesh.colors = MemAlloc(mesh.vertexCount * 4 * sizeof(unsigned char));
+mesh->colors = MemAlloc(mesh->vertexCount * 4 * sizeof(unsigned char));
 
-for (int vi = 0; vi < mesh.vertexCount; vi++)
+for (int vi = 0; vi < mesh->vertexCount; vi++)
 {
-    float nx = mesh.normals[vi*3 + 0];
-    float ny = mesh.normals[vi*3 + 1];
-    float nz = mesh.normals[vi*3 + 2];
+    float nx = mesh->normals[vi*3 + 0];
+    float ny = mesh->normals[vi*3 + 1];
+    float nz = mesh->normals[vi*3 + 2];
     float dp = nx*lightDir.x + ny*lightDir.y + nz*lightDir.z;
     float intensity = ambient + (1.0f - ambient) * fmaxf(0.0f, dp);
 
     unsigned char c = (unsigned char)(fminf(1.0f, intensity) * 255.0f);
-    mesh.colors[vi*4 + 0] = c; // R
-    mesh.colors[vi*4 + 1] = c; // G
-    mesh.colors[vi*4 + 2] = c; // B
-    mesh.colors[vi*4 + 3] = 255; // A
+    mesh->colors[vi*4 + 0] = c; // R
+    mesh->colors[vi*4 + 1] = c; // G
+    mesh->colors[vi*4 + 2] = c; // B
+    mesh->colors[vi*4 + 3] = 255; // A
+}
 }
 
-    UploadMesh(&mesh, false);
-    return mesh;
+int generateChunkMesh(const ChunkSnapshot *snapshot, Mesh **parts)
+{
+    return generateLodChunkMesh(snapshot, 0, parts);
+}
+
+int generateLodChunkMesh(const ChunkSnapshot *snapshot, int lod, Mesh **parts)
+{
+    QuadList *scratch = collectChunkQuads(snapshot, lod);
+    float scale = (float)(1 << lod);
+
+    *parts = NULL;
+    if (scratch->count == 0) return 0;
+
+    //raylib meshes index with unsigned short, so busy chunks are split into parts that each stay under 65536 vertices
+    int partCount = (scratch->count + MAX_QUADS_PER_MESH - 1) / MAX_QUADS_PER_MESH;
+    *parts = MemAlloc(partCount * sizeof(Mesh));
+
+    size_t bytes = 0;
+    for (int p = 0; p < partCount; p++)
+    {
+        int first = p * MAX_QUADS_PER_MESH;
+        int quadCount = scratch->count - first;
+        if (quadCount > MAX_QUADS_PER_MESH) quadCount = MAX_QUADS_PER_MESH;
+
+        Mesh *mesh = &(*parts)[p];
+        mesh->vertexCount = quadCount * 4;
+        mesh->triangleCount = quadCount * 2;
+        mesh->vertices = MemAlloc(mesh->vertexCount * 3 * sizeof(float));
+        mesh->normals = MemAlloc(mesh->vertexCount * 3 * sizeof(float));
+        mesh->texcoords = MemAlloc(mesh->vertexCount * 2 * sizeof(float));
+        mesh->indices = MemAlloc(mesh->triangleCount * 3 * sizeof(unsigned short));
+
+        int v = 0;
+        int idx = 0;
+        for (int q = first; q < first + quadCount; q++)
+        {
+            const MeshQuad *quad = &scratch->quads[q];
+            addFace(mesh, &v, &idx, quad->face, (Vector3){quad->x, quad->y, quad->z}, quad->width, quad->height);
+        }
+        for (int c = 0; scale > 1.0f && c < mesh->vertexCount * 3; c++)
+            mesh->vertices[c] *= scale;
+        bakeLighting(mesh);
+        bytes += meshDataBytes(mesh);
+    }
+
+    recordBuildBytes(scratch, bytes);
+
+    //CPU side only, the GPU upload happens on the main thread
+    return partCount;
 }
 
-void greedyMesh(Mesh *mesh, struct Chunk ***chunks, int *v, int *i, int face, int cx, int cy, int cz)
+void greedyMesh(QuadList *quads, const ChunkSnapshot *snapshot, int face)
 {
     //Determine axis and direction based on face
     //face: 0=+Z, 1=-Z, 2=+X, 3=-X, 4=+Y, 5=-Y
@@ -113,35 +363,9 @@ void greedyMesh(Mesh *mesh, struct Chunk ***chunks, int *v, int *i, int face, in
                     nx = x; ny = y + dir; nz = z;
                 }
                 
-                //Check if this block is solid and if neighbor is empty (including across chunk boundaries)
-                bool is_solid = chunks[cx][cy][cz].blocks[x][y][z] != 0;
-
-                bool neighborEmpty = false;
-                if (nx >= 0 && nx < CHUNK_WIDTH && ny >= 0 && ny < CHUNK_HEIGHT && nz >= 0 && nz < CHUNK_WIDTH)
-                {
-                    //neighbor inside same chunk
-                    neighborEmpty = (chunks[cx][cy][cz].blocks[nx][ny][nz] == 0);
-                }
-                else
-                {
-                    //neighbor lies in adjacent chunk — map to neighbor chunk coords and in-chunk indices
-                    int ncx = cx + (nx < 0 ? -1 : (nx >= CHUNK_WIDTH ? 1 : 0));
-                    int ncy = cy + (ny < 0 ? -1 : (ny >= CHUNK_HEIGHT ? 1 : 0));
-                    int ncz = cz + (nz < 0 ? -1 : (nz >= CHUNK_WIDTH ? 1 : 0));
-
-                    if (ncx < 0 || ncx >= WORLD_SIZE_CHUNKS || ncy < 0 || ncy >= 1 || ncz < 0 || ncz >= WORLD_SIZE_CHUNKS)
-                    {
-                        //no neighbor chunk -> treat as air
-                        neighborEmpty = true;
-                    }
-                    else
-                    {
-                        int bx = (nx < 0) ? (CHUNK_WIDTH - 1) : (nx >= CHUNK_WIDTH ? 0 : nx);
-                        int by = (ny < 0) ? (CHUNK_HEIGHT - 1) : (ny >= CHUNK_HEIGHT ? 0 : ny);
-                        int bz = (nz < 0) ? (CHUNK_WIDTH - 1) : (nz >= CHUNK_WIDTH ? 0 : nz);
-                        neighborEmpty = (chunks[ncx][ncy][ncz].blocks[bx][by][bz] == 0);
-                    }
-                }
+                //Check if this block is solid and if neighbor is empty, the snapshot padding holds the neighbouring chunks' borders
+                bool is_solid = snapshot->blocks[x + 1][y + 1][z + 1] != 0;
+                bool neighborEmpty = snapshot->blocks[nx + 1][ny + 1][nz + 1] == 0;
 
                 mask[w][h] = (is_solid && neighborEmpty) ? 1 : 0;
             }
@@ -178,17 +402,14 @@ void greedyMesh(Mesh *mesh, struct Chunk ***chunks, int *v, int *i, int face, in
                 }
                 
                 // Calculate position based on axis
-                Vector3 offset;
                 if (axis == 0) { // Z axis
-                    offset = (Vector3){(float)w, (float)h, (float)d};
+                    pushQuad(quads, face, w, h, d, width, height);
                 } else if (axis == 1) { // X axis
-                    offset = (Vector3){(float)d, (float)h, (float)w};
+                    pushQuad(quads, face, d, h, w, width, height);
                 } else { // Y axis
-                    offset = (Vector3){(float)w, (float)d, (float)h};
+                    pushQuad(quads, face, w, d, h, width, height);
                 }
                 
-                addFace(mesh, v, i, face, offset, width, height);
-                
                 // Clear mask
                 for (int hh = 0; hh < height; hh++)
                 {
@@ -202,7 +423,164 @@ void greedyMesh(Mesh *mesh, struct Chunk ***chunks, int *v, int *i, int face, in
     }
 }
 
-void addFace(Mesh *mesh, int *v, int *i, int face, Vector3 offset, int width, int height)
+//Greedy merge of one slice where rows[h] has bit w set for every visible face. Same scan order as greedyMesh
+static void mergeFaceRows(QuadList *quads, int face, int d, uint32_t *rows, int rowCount)
+{
+    int axis = face / 2;
+    for (int h = 0; h < rowCount; h++)
+    {
+        while (rows[h])
+        {
+            int w = __builtin_ctz(rows[h]);
+            int width = __builtin_ctz(~(rows[h] >> w));
+            uint32_t run = ((1u << width) - 1) << w;
+            rows[h] &= ~run;
+
+            int height = 1;
+            while (h + height < rowCount && (rows[h + height] & run) == run)
+            {
+                rows[h + height] &= ~run;
+                height++;
+            }
+
+            if (axis == 0) pushQuad(quads, face, w, h, d, width, height);
+            else if (axis == 1) pushQuad(quads, face, d, h, w, width, height);
+            else pushQuad(quads, face, w, d, h, width, height);
+        }
+    }
+}
+
+_Static_assert(CHUNK_HEIGHT <= 64, "binaryGreedyMesh keeps a chunk column in one uint64_t");
+
+//Greedy faces of a width x height x width occupancy grid. cols[x + 1][z + 1] has bit y set for a solid cell,
+//the padding holds the neighbouring cells. above / below say whether the cell just past the top / bottom is solid
+static void meshOccupancy(QuadList *quads, const uint64_t cols[CHUNK_WIDTH + 2][CHUNK_WIDTH + 2],
+                          const uint64_t above[CHUNK_WIDTH][CHUNK_WIDTH], const uint64_t below[CHUNK_WIDTH][CHUNK_WIDTH],
+                          int width, int height)
+{
+    uint32_t rows[CHUNK_HEIGHT];
+
+    //Z and X faces: a whole column of faces is one AND-NOT against the neighbouring column,
+    //then set bits are scattered into rows over the slice width
+    for (int face = 0; face < 4; face++)
+    {
+        int axis = face / 2;
+        int dir = (face % 2 == 0) ? 1 : -1;
+        for (int d = 0; d < width; d++)
+        {
+            memset(rows, 0, sizeof(rows));
+            for (int w = 0; w < width; w++)
+            {
+                uint64_t visible;
+                if (axis == 0) visible = cols[w + 1][d + 1] & ~cols[w + 1][d + 1 + dir];
+                else           visible = cols[d + 1][w + 1] & ~cols[d + 1 + dir][w + 1];
+
+                while (visible)
+                {
+                    rows[__builtin_ctzll(visible)] |= 1u << w;
+                    visible &= visible - 1;
+                }
+            }
+            mergeFaceRows(quads, face, d, rows, height);
+        }
+    }
+
+    //Y faces: shift the column against itself, slices are y and rows run along z
+    static const int yFaces[2] = {4, 5};
+    for (int f = 0; f < 2; f++)
+    {
+        int face = yFaces[f];
+        uint32_t slices[CHUNK_HEIGHT][CHUNK_WIDTH] = {0};
+        for (int x = 0; x < width; x++)
+        {
+            for (int z = 0; z < width; z++)
+            {
+                uint64_t col = cols[x + 1][z + 1];
+                uint64_t visible = (face == 4) ? col & ~((col >> 1) | (above[x][z] << (height - 1)))
+                                               : col & ~((col << 1) | below[x][z]);
+                while (visible)
+                {
+                    slices[__builtin_ctzll(visible)][z] |= 1u << x;
+                    visible &= visible - 1;
+                }
+            }
+        }
+        for (int d = 0; d < height; d++)
+            mergeFaceRows(quads, face, d, slices[d], width);
+    }
+}
+
+void binaryGreedyMesh(QuadList *quads, const ChunkSnapshot *snapshot)
+{
+    //One 64 bit occupancy column per (x, z) including the padding, bit y = block at y
+    uint64_t cols[CHUNK_WIDTH + 2][CHUNK_WIDTH + 2];
+    //Whether the block just above/below the chunk is solid, for the Y faces
+    uint64_t above[CHUNK_WIDTH][CHUNK_WIDTH];
+    uint64_t below[CHUNK_WIDTH][CHUNK_WIDTH];
+
+    for (int px = 0; px < CHUNK_WIDTH + 2; px++)
+    {
+        for (int pz = 0; pz < CHUNK_WIDTH + 2; pz++)
+        {
+            uint64_t col = 0;
+            for (int y = 0; y < CHUNK_HEIGHT; y++)
+                col |= (uint64_t)(snapshot->blocks[px][y + 1][pz] != 0) << y;
+            cols[px][pz] = col;
+        }
+    }
+    for (int x = 0; x < CHUNK_WIDTH; x++)
+    {
+        for (int z = 0; z < CHUNK_WIDTH; z++)
+        {
+            above[x][z] = snapshot->blocks[x + 1][CHUNK_HEIGHT + 1][z + 1] != 0;
+            below[x][z] = snapshot->blocks[x + 1][0][z + 1] != 0;
+        }
+    }
+    meshOccupancy(quads, cols, above, below, CHUNK_WIDTH, CHUNK_HEIGHT);
+}
+
+void lodGreedyMesh(QuadList *quads, const ChunkSnapshot *snapshot, int lod)
+{
+    if (lod == 0)
+    {
+        binaryGreedyMesh(quads, snapshot);
+        return;
+    }
+
+    //A cell is solid when at least half of its blocks are
+    int scale = 1 << lod;
+    int width = CHUNK_WIDTH / scale;
+    int height = CHUNK_HEIGHT / scale;
+    int half = scale * scale * scale / 2;
+
+    //Padding stays air: every side gets its faces, which closes the cracks against neighbours
+    //meshed at another level (or at this level from differently rounded cells)
+    uint64_t cols[CHUNK_WIDTH + 2][CHUNK_WIDTH + 2] = {0};
+    uint64_t above[CHUNK_WIDTH][CHUNK_WIDTH] = {0};
+    uint64_t below[CHUNK_WIDTH][CHUNK_WIDTH] = {0};
+    for (int cx = 0; cx < width; cx++)
+    {
+        for (int cz = 0; cz < width; cz++)
+        {
+            uint64_t col = 0;
+            for (int cy = 0; cy < height; cy++)
+            {
+                int solid = 0;
+                for (int x = cx * scale; x < (cx + 1) * scale; x++)
+                    for (int y = cy * scale; y < (cy + 1) * scale; y++)
+                        for (int z = cz * scale; z < (cz + 1) * scale; z++)
+                            solid += snapshot->blocks[x + 1][y + 1][z + 1] != 0;
+                col |= (uint64_t)(solid >= half) << cy;
+            }
+            cols[cx + 1][cz + 1] = col;
+            //Below the world is still solid, so the bottom layer keeps no floor
+            below[cx][cz] = snapshot->cy == 0;
+        }
+    }
+    meshOccupancy(quads, cols, above, below, width, height);
+}
+
+void faceCorners(int face, int width, int height, Vector3 *corners, Vector2 *uvs)
 {
     Vector3 p0, p1, p2, p3;
     Vector2 uv0, uv1, uv2, uv3;  // Custom UVs per face
@@ -266,8 +644,15 @@ void addFace(Mesh *mesh, int *v, int *i, int face, Vector3 offset, int width, in
             break;
     }
 
-    Vector3 verts[4] = {p0, p1, p2, p3};
-    Vector2 uvs[4] = {uv0, uv1, uv2, uv3};
+    corners[0] = p0; corners[1] = p1; corners[2] = p2; corners[3] = p3;
+    uvs[0] = uv0; uvs[1] = uv1; uvs[2] = uv2; uvs[3] = uv3;
+}
+
+void addFace(Mesh *mesh, int *v, int *i, int face, Vector3 offset, int width, int height)
+{
+    Vector3 verts[4];
+    Vector2 uvs[4];
+    faceCorners(face, width, height, verts, uvs);
 
     for (int vi = 0; vi < 4; vi++)
     {
@@ -2,9 +2,55 @@
 #define MESH_H
 
 #include "chunk.h"
+#include <stdint.h>
 
-Mesh generateChunkMesh(Chunk ***chunks, int cx, int cy, int cz);
-void greedyMesh(Mesh *mesh, Chunk ***chunks, int *v, int *i, int face, int cx, int cy, int cz);
+//Copy of a chunk plus a one block border from its face neighbours, so meshing can run off the main thread
+typedef struct ChunkSnapshot {
+    int cx, cy, cz;
+    uint8_t blocks[CHUNK_WIDTH + 2][CHUNK_HEIGHT + 2][CHUNK_WIDTH + 2]; //[x + 1][y + 1][z + 1]
+} ChunkSnapshot;
+
+//One merged face, in chunk local block units
+typedef struct MeshQuad {
+    uint8_t face;
+    uint8_t x, y, z;
+    uint8_t width, height;
+} MeshQuad;
+
+typedef struct QuadList {
+    MeshQuad *quads;
+    int count;
+    int capacity;
+} QuadList;
+
+//Quads per float sub-mesh, keeps every index inside unsigned short
+#define MAX_QUADS_PER_MESH (65536 / 4)
+
+void snapshotChunk(ChunkSnapshot *snapshot, int cx, int cy, int cz);
+//64 bit hash of every block the mesher reads, the chunk and its neighbours' border slices
+uint64_t hashSnapshot(const ChunkSnapshot *snapshot);
+//Lowest and highest block rows holding anything but air, false for an empty chunk
+bool snapshotOccupiedRows(const ChunkSnapshot *snapshot, int *minY, int *maxY);
+//Mesh arrays are sized to the quads actually emitted, CPU side only. Returns the number of parts
+//written to *parts (MemAlloc'd, NULL when the chunk has no faces)
+int generateChunkMesh(const ChunkSnapshot *snapshot, Mesh **parts);
+PackedMesh generatePackedChunkMesh(const ChunkSnapshot *snapshot);
+//Same as above at a reduced level (see LOD_RADIUS), vertices stay in chunk local block units
+int generateLodChunkMesh(const ChunkSnapshot *snapshot, int lod, Mesh **parts);
+PackedMesh generatePackedLodMesh(const ChunkSnapshot *snapshot, int lod);
+void greedyMesh(QuadList *quads, const ChunkSnapshot *snapshot, int face);
+//Same faces as greedyMesh for all six directions, built from 64 bit column occupancy with shifts and masks
+void binaryGreedyMesh(QuadList *quads, const ChunkSnapshot *snapshot);
+//binaryGreedyMesh over cells of (1 << lod) blocks, solid when at least half the blocks are. Quads are in cells.
+//Every side of the chunk is meshed as if open, so levels meeting at a border leave no gaps
+void lodGreedyMesh(QuadList *quads, const ChunkSnapshot *snapshot, int lod);
+void pushQuad(QuadList *list, int face, int x, int y, int z, int width, int height);
+size_t meshDataBytes(const Mesh *mesh);
+size_t packedMeshBytes(const PackedMesh *mesh);
+size_t modelDataBytes(const Model *model);
+//Largest scratch + output footprint of a single chunk build so far
+size_t getPeakMeshBuildBytes(void);
+void faceCorners(int face, int width, int height, Vector3 *corners, Vector2 *uvs);
 void addFace(Mesh *mesh, int *v, int *i, int face, Vector3 offset, int width, int height);
 
 #endif
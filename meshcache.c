@@ -0,0 +1,254 @@
+#include "meshcache.h"
+#include "render.h"
+#include "config.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MESH_CACHE_BUCKETS 4096 //Chained, a few thousand entries fit a normal budget
+
+typedef struct CacheEntry {
+    uint64_t key;
+    uint64_t hash;
+    CachedMesh mesh;        //vertices are NULL while spilled
+    bool spilled;
+    long spillOffset;
+    struct CacheEntry *prev; //Recency list of the entries in memory, newest at the head
+    struct CacheEntry *next;
+    struct CacheEntry *chain;
+} CacheEntry;
+
+static pthread_mutex_t cacheLock = PTHREAD_MUTEX_INITIALIZER;
+static CacheEntry *buckets[MESH_CACHE_BUCKETS];
+static CacheEntry *newest = NULL;
+static CacheEntry *oldest = NULL;
+static size_t budget = 0;
+static FILE *spillFile = NULL;
+static char *spillPath = NULL;
+static MeshCacheStats stats = {0};
+
+static size_t vertexBytes(const CachedMesh *mesh)
+{
+    return (size_t)mesh->vertexCount * PACKED_VERTEX_SIZE;
+}
+
+//Memory an in-memory entry is charged against the budget
+static size_t entryBytes(const CacheEntry *entry)
+{
+    return sizeof(CacheEntry) + vertexBytes(&entry->mesh);
+}
+
+static CacheEntry **bucketFor(uint64_t key)
+{
+    return &buckets[(key * 0x9E3779B97F4A7C15ULL) >> 52];
+}
+
+static CacheEntry *findEntry(uint64_t key)
+{
+    for (CacheEntry *entry = *bucketFor(key); entry != NULL; entry = entry->chain)
+        if (entry->key == key) return entry;
+    return NULL;
+}
+
+static void unlinkRecent(CacheEntry *entry)
+{
+    if (entry->prev) entry->prev->next = entry->next;
+    else newest = entry->next;
+    if (entry->next) entry->next->prev = entry->prev;
+    else oldest = entry->prev;
+    entry->prev = entry->next = NULL;
+}
+
+static void linkNewest(CacheEntry *entry)
+{
+    entry->prev = NULL;
+    entry->next = newest;
+    if (newest) newest->prev = entry;
+    else oldest = entry;
+    newest = entry;
+}
+
+static void removeEntry(CacheEntry *entry)
+{
+    CacheEntry **link = bucketFor(entry->key);
+    while (*link != entry) link = &(*link)->chain;
+    *link = entry->chain;
+
+    if (entry->spilled)
+    {
+        stats.spillEntries--;
+    }
+    else
+    {
+        unlinkRecent(entry);
+        stats.bytes -= entryBytes(entry);
+        stats.entries--;
+        free(entry->mesh.vertices);
+    }
+    free(entry);
+}
+
+//Starts the spill file over, everything in it is forgotten
+static void resetSpill(void)
+{
+    for (int b = 0; b < MESH_CACHE_BUCKETS; b++)
+    {
+        CacheEntry *entry = buckets[b];
+        while (entry != NULL)
+        {
+            CacheEntry *next = entry->chain;
+            if (entry->spilled) removeEntry(entry);
+            entry = next;
+        }
+    }
+    fclose(spillFile);
+    spillFile = fopen(spillPath, "w+b");
+    stats.spillBytes = 0;
+}
+
+//Oldest entry out of memory: into the spill file when there is one, otherwise gone
+static void evictOldest(void)
+{
+    CacheEntry *entry = oldest;
+    stats.evictions++;
+    size_t bytes = vertexBytes(&entry->mesh);
+    if (spillFile != NULL && stats.spillBytes + bytes > MESH_CACHE_SPILL_BYTES) resetSpill();
+    if (spillFile == NULL)
+    {
+        removeEntry(entry);
+        return;
+    }
+
+    fseek(spillFile, 0, SEEK_END);
+    entry->spillOffset = ftell(spillFile);
+    if (bytes > 0 && fwrite(entry->mesh.vertices, 1, bytes, spillFile) != bytes)
+    {
+        removeEntry(entry);
+        return;
+    }
+    unlinkRecent(entry);
+    stats.bytes -= entryBytes(entry);
+    stats.entries--;
+    free(entry->mesh.vertices);
+    entry->mesh.vertices = NULL;
+    entry->spilled = true;
+    stats.spillEntries++;
+    stats.spillBytes += bytes;
+}
+
+void initMeshCache(size_t budgetBytes, const char *path)
+{
+    budget = budgetBytes;
+    stats = (MeshCacheStats){0};
+    if (budget == 0 || path == NULL) return;
+
+    spillFile = fopen(path, "w+b");
+    if (spillFile == NULL)
+    {
+        printf("Could not open %s, mesh cache spill is off\n", path);
+        return;
+    }
+    spillPath = malloc(strlen(path) + 1);
+    strcpy(spillPath, path);
+}
+
+void shutdownMeshCache(void)
+{
+    pthread_mutex_lock(&cacheLock);
+    for (int b = 0; b < MESH_CACHE_BUCKETS; b++)
+        while (buckets[b] != NULL)
+            removeEntry(buckets[b]);
+    if (spillFile != NULL)
+    {
+        //Only useful within one run
+        fclose(spillFile);
+        remove(spillPath);
+        free(spillPath);
+        spillFile = NULL;
+        spillPath = NULL;
+    }
+    budget = 0;
+    pthread_mutex_unlock(&cacheLock);
+}
+
+bool fetchCachedMesh(uint64_t key, uint64_t hash, CachedMesh *out)
+{
+    pthread_mutex_lock(&cacheLock);
+    stats.lookups++;
+    CacheEntry *entry = findEntry(key);
+    bool hit = entry != NULL && entry->hash == hash;
+    if (hit)
+    {
+        *out = entry->mesh;
+        size_t bytes = vertexBytes(&entry->mesh);
+        out->vertices = (bytes > 0) ? MemAlloc((unsigned int)bytes) : NULL;
+        if (!entry->spilled)
+        {
+            if (bytes > 0) memcpy(out->vertices, entry->mesh.vertices, bytes);
+            unlinkRecent(entry);
+            linkNewest(entry);
+            stats.hits++;
+        }
+        else
+        {
+            fseek(spillFile, entry->spillOffset, SEEK_SET);
+            hit = bytes == 0 || fread(out->vertices, 1, bytes, spillFile) == bytes;
+            if (hit) stats.spillHits++;
+            else MemFree(out->vertices);
+        }
+    }
+    pthread_mutex_unlock(&cacheLock);
+    return hit;
+}
+
+void storeCachedMesh(uint64_t key, uint64_t hash, const CachedMesh *mesh)
+{
+    pthread_mutex_lock(&cacheLock);
+    if (budget == 0)
+    {
+        pthread_mutex_unlock(&cacheLock);
+        return;
+    }
+
+    CacheEntry *entry = findEntry(key);
+    if (entry != NULL) removeEntry(entry);
+    entry = calloc(1, sizeof(CacheEntry));
+    entry->key = key;
+    entry->hash = hash;
+    entry->mesh = *mesh;
+    size_t bytes = vertexBytes(mesh);
+    entry->mesh.vertices = (bytes > 0) ? malloc(bytes) : NULL;
+    if (bytes > 0) memcpy(entry->mesh.vertices, mesh->vertices, bytes);
+
+    CacheEntry **bucket = bucketFor(key);
+    entry->chain = *bucket;
+    *bucket = entry;
+    linkNewest(entry);
+    stats.entries++;
+    stats.bytes += entryBytes(entry);
+
+    while (stats.bytes > budget && oldest != NULL)
+        evictOldest();
+    pthread_mutex_unlock(&cacheLock);
+}
+
+void touchCachedMesh(uint64_t key)
+{
+    pthread_mutex_lock(&cacheLock);
+    CacheEntry *entry = findEntry(key);
+    if (entry != NULL && !entry->spilled)
+    {
+        unlinkRecent(entry);
+        linkNewest(entry);
+    }
+    pthread_mutex_unlock(&cacheLock);
+}
+
+MeshCacheStats getMeshCacheStats(void)
+{
+    pthread_mutex_lock(&cacheLock);
+    MeshCacheStats copy = stats;
+    pthread_mutex_unlock(&cacheLock);
+    return copy;
+}
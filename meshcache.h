@@ -0,0 +1,40 @@
+#ifndef MESHCACHE_H
+#define MESHCACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+//CPU copies of built packed chunk meshes, keyed by chunk (packChunkKey) and checked against the hash of the
+//snapshot they were built from. A chunk that comes back unchanged only needs its GPU upload.
+//Least recently used entries go first once the byte budget is full, to the spill file if there is one
+typedef struct CachedMesh {
+    uint8_t *vertices; //vertexCount * PACKED_VERTEX_SIZE bytes, NULL when empty
+    int vertexCount;
+    int minY, maxY;
+    uint16_t visibility;
+} CachedMesh;
+
+typedef struct MeshCacheStats {
+    long long lookups;
+    long long hits;         //Served from memory
+    long long spillHits;    //Read back from the spill file
+    long long evictions;    //Pushed out of memory by the budget
+    int entries;
+    size_t bytes;           //Vertex bytes held in memory
+    int spillEntries;
+    size_t spillBytes;      //Size of the spill file
+} MeshCacheStats;
+
+//budgetBytes 0 turns the cache off. spillPath NULL drops evicted meshes instead of writing them out
+void initMeshCache(size_t budgetBytes, const char *spillPath);
+void shutdownMeshCache(void);
+//On a hit out gets its own copy of the vertices (MemAlloc'd). Safe from the mesh workers
+bool fetchCachedMesh(uint64_t key, uint64_t hash, CachedMesh *out);
+//Copies mesh in, replacing whatever the chunk had before
+void storeCachedMesh(uint64_t key, uint64_t hash, const CachedMesh *mesh);
+//Marks the chunk's entry most recently used, called as its mesh leaves the GPU so unloaded chunks stay longest
+void touchCachedMesh(uint64_t key);
+MeshCacheStats getMeshCacheStats(void);
+
+#endif
@@ -0,0 +1,330 @@
+#include "meshjobs.h"
+#include "chunk.h"
+#include "mesh.h"
+#include "threadpool.h"
+#include "visibility.h"
+#include "meshcache.h"
+#include "chunkmap.h"
+#include "mapfile.h"
+#include "drawbatch.h"
+#include <stdatomic.h>
+#include <stdlib.h>
+
+typedef struct MeshJob {
+    struct MeshJob *next;
+    unsigned int version;
+    ChunkSnapshot snapshot;
+    Mesh *parts;    //Float meshes, split so no part overflows its 16 bit indices
+    int partCount;
+    PackedMesh packed;
+    int minY, maxY;
+    uint16_t visibility;
+    uint64_t hash;  //Of the snapshot and level, checks the mesh cache entry
+    bool cached;    //Came out of the mesh cache, nothing new to store
+    int lod;
+    double buildSeconds;
+} MeshJob;
+
+static ThreadPool *meshPool = NULL;
+//Workers push finished jobs here without locking, the main thread takes the whole stack at once
+static _Atomic(MeshJob *) completedJobs = NULL;
+//Finished jobs waiting for upload, oldest first. Main thread only
+static MeshJob *uploadHead = NULL;
+static MeshJob *uploadTail = NULL;
+static int pendingJobs = 0;
+//Build ids are unique across chunks, so a chunk evicted and loaded again can't pick up an old build
+static unsigned int nextMeshVersion = 0;
+static size_t residentBytes = 0;
+static int residentMeshes = 0;
+static int skippedMeshes = 0;
+//Per level: uploaded meshes and their triangles, and the builds done so far
+static int lodMeshes[LOD_LEVELS];
+static long long lodTriangles[LOD_LEVELS];
+static long long lodBuilds[LOD_LEVELS];
+static double lodBuildSeconds[LOD_LEVELS];
+
+static long long modelTriangles(const Model *model)
+{
+    long long triangles = 0;
+    for (int m = 0; m < model->meshCount; m++)
+        triangles += model->meshes[m].triangleCount;
+    return triangles;
+}
+
+static void completeMeshJob(MeshJob *job)
+{
+    MeshJob *head = atomic_load_explicit(&completedJobs, memory_order_relaxed);
+    do {
+        job->next = head;
+    } while (!atomic_compare_exchange_weak_explicit(&completedJobs, &head, job, memory_order_release, memory_order_relaxed));
+}
+
+static void runMeshJob(void *arg)
+{
+    MeshJob *job = arg;
+#if CHUNK_PACKED_VERTICES
+    //A chunk back with the same blocks and borders reuses its last build
+    job->hash = hashSnapshot(&job->snapshot) ^ ((uint64_t)job->lod * 0x9E3779B97F4A7C15ULL);
+    CachedMesh cached;
+    if (fetchCachedMesh(packChunkKey(job->snapshot.cx, job->snapshot.cy, job->snapshot.cz), job->hash, &cached))
+    {
+        job->packed.vertices = cached.vertices;
+        job->packed.vertexCount = cached.vertexCount;
+        job->minY = cached.minY;
+        job->maxY = cached.maxY;
+        job->visibility = cached.visibility;
+        job->cached = true;
+        completeMeshJob(job);
+        return;
+    }
+#endif
+    double start = getWallTime();
+    if (!snapshotOccupiedRows(&job->snapshot, &job->minY, &job->maxY))
+        job->minY = job->maxY = 0;
+    //Reduced cells can stick out past the blocks they round, widen the culling box to whole cells
+    int scale = 1 << job->lod;
+    job->minY -= job->minY % scale;
+    job->maxY += scale - 1 - job->maxY % scale;
+    job->visibility = computeFaceConnectivity(&job->snapshot);
+#if CHUNK_PACKED_VERTICES
+    job->packed = generatePackedLodMesh(&job->snapshot, job->lod);
+#else
+    job->partCount = generateLodChunkMesh(&job->snapshot, job->lod, &job->parts);
+#endif
+    job->buildSeconds = getWallTime() - start;
+    completeMeshJob(job);
+}
+
+//keepBatchRange leaves a batched mesh's vertices in place for a replacement to patch over
+static void dropChunkMesh(Chunk *chunk, bool keepBatchRange)
+{
+    if (chunk->model.meshCount > 0)
+    {
+        residentBytes -= modelDataBytes(&chunk->model);
+        residentMeshes--;
+        lodMeshes[chunk->meshLod]--;
+        lodTriangles[chunk->meshLod] -= modelTriangles(&chunk->model);
+        UnloadModel(chunk->model);
+    }
+    if (chunk->packed.vertexCount > 0)
+    {
+        touchCachedMesh(packChunkKey(chunk->cx, chunk->cy, chunk->cz));
+        residentBytes -= packedMeshBytes(&chunk->packed);
+        residentMeshes--;
+        lodMeshes[chunk->meshLod]--;
+        lodTriangles[chunk->meshLod] -= chunk->packed.vertexCount / 3;
+#if CHUNK_BATCHING
+        if (!keepBatchRange)
+            removeBatchedMesh(chunk->cx, chunk->cy, chunk->cz);
+#endif
+        unloadPackedMesh(&chunk->packed);
+    }
+    chunk->model = (Model){0};
+}
+
+static void freeMeshJob(MeshJob *job)
+{
+    for (int p = 0; p < job->partCount; p++)
+        UnloadMesh(job->parts[p]);
+    MemFree(job->parts);
+    unloadPackedMesh(&job->packed);
+    free(job);
+}
+
+static void collectCompletedJobs(void)
+{
+    MeshJob *list = atomic_exchange_explicit(&completedJobs, NULL, memory_order_acquire);
+
+    //The stack comes out newest first, flip it so uploads keep completion order
+    MeshJob *ordered = NULL;
+    while (list != NULL)
+    {
+        MeshJob *next = list->next;
+        list->next = ordered;
+        ordered = list;
+        list = next;
+    }
+
+    while (ordered != NULL)
+    {
+        MeshJob *next = ordered->next;
+        ordered->next = NULL;
+        if (uploadTail) uploadTail->next = ordered;
+        else uploadHead = ordered;
+        uploadTail = ordered;
+        ordered = next;
+    }
+}
+
+void initMeshJobs(int workerCount)
+{
+    //Leave a core for the render thread
+    if (workerCount <= 0)
+        workerCount = getCpuCount() - 1;
+    meshPool = createThreadPool(workerCount);
+#if MESH_CACHE_SPILL
+    makeDirectory(WORLD_DIRECTORY);
+    initMeshCache(MESH_CACHE_BYTES, WORLD_DIRECTORY "/meshes.cache");
+#else
+    initMeshCache(MESH_CACHE_BYTES, NULL);
+#endif
+}
+
+void shutdownMeshJobs(void)
+{
+    destroyThreadPool(meshPool);
+    meshPool = NULL;
+
+    collectCompletedJobs();
+    while (uploadHead != NULL)
+    {
+        MeshJob *job = uploadHead;
+        uploadHead = job->next;
+        freeMeshJob(job);
+    }
+    uploadTail = NULL;
+    pendingJobs = 0;
+    shutdownMeshCache();
+}
+
+void requestChunkMesh(int cx, int cy, int cz)
+{
+    Chunk *chunk = getChunk(cx, cy, cz);
+    if (chunk == NULL) return;
+
+    //Open sky and buried rock finish here without a snapshot, a newer id drops any build still in flight
+    uint16_t visibility;
+    if (chunkHasNoFaces(chunk, &visibility))
+    {
+        releaseChunkMesh(chunk);
+        chunk->meshVersion = ++nextMeshVersion;
+        chunk->meshQueued = false;
+        chunk->meshed = true;
+        chunk->minY = 0;
+        chunk->maxY = CHUNK_HEIGHT - 1;
+        chunk->visibility = visibility;
+        skippedMeshes++;
+        return;
+    }
+
+    MeshJob *job = malloc(sizeof(MeshJob));
+    job->next = NULL;
+    job->parts = NULL;
+    job->partCount = 0;
+    job->packed = (PackedMesh){0};
+    job->hash = 0;
+    job->cached = false;
+    job->lod = chunk->lod;
+    job->buildSeconds = 0.0;
+    job->version = chunk->meshVersion = ++nextMeshVersion;
+    snapshotChunk(&job->snapshot, cx, cy, cz);
+    chunk->meshQueued = true;
+    pendingJobs++;
+    submitJob(meshPool, runMeshJob, job);
+}
+
+void processMeshUploads(Shader fogShader)
+{
+#if CHUNK_PACKED_VERTICES
+    (void)fogShader; //Packed meshes get the shader when they are drawn, only models keep it in their materials
+#endif
+    collectCompletedJobs();
+
+    size_t uploaded = 0;
+    while (uploadHead != NULL && uploaded < MESH_UPLOAD_BUDGET_BYTES)
+    {
+        MeshJob *job = uploadHead;
+        uploadHead = job->next;
+        if (uploadHead == NULL) uploadTail = NULL;
+        pendingJobs--;
+
+        //A newer request, an unload or an eviction happened while this was in flight
+        Chunk *chunk = findChunk(job->snapshot.cx, job->snapshot.cy, job->snapshot.cz);
+        if (chunk == NULL || job->version != chunk->meshVersion)
+        {
+            freeMeshJob(job);
+            continue;
+        }
+
+        //Swap in the replacement, the old model kept drawing until now. A batched mesh is overwritten where it is
+        dropChunkMesh(chunk, job->packed.vertexCount > 0);
+        chunk->meshQueued = false;
+        chunk->meshed = true;
+        chunk->minY = job->minY;
+        chunk->maxY = job->maxY;
+        chunk->visibility = job->visibility;
+        chunk->meshLod = (uint8_t)job->lod;
+        if (!job->cached)
+        {
+            lodBuilds[job->lod]++;
+            lodBuildSeconds[job->lod] += job->buildSeconds;
+        }
+
+#if CHUNK_PACKED_VERTICES
+        if (!job->cached)
+        {
+            CachedMesh built = { job->packed.vertices, job->packed.vertexCount, job->minY, job->maxY, job->visibility };
+            storeCachedMesh(packChunkKey(chunk->cx, chunk->cy, chunk->cz), job->hash, &built);
+        }
+        if (job->packed.vertexCount > 0)
+        {
+            size_t bytes = packedMeshBytes(&job->packed);
+#if CHUNK_BATCHING
+            //The batch keeps its own copy, the chunk only remembers that it has a mesh
+            storeBatchedMesh(chunk->cx, chunk->cy, chunk->cz, job->packed.vertices, job->packed.vertexCount);
+            chunk->packed = (PackedMesh){ .vertexCount = job->packed.vertexCount };
+#else
+            uploadPackedMesh(&job->packed);
+            chunk->packed = job->packed;
+            job->packed = (PackedMesh){0};
+#endif
+            uploaded += bytes;
+            residentBytes += bytes;
+            residentMeshes++;
+            lodMeshes[chunk->meshLod]++;
+            lodTriangles[chunk->meshLod] += chunk->packed.vertexCount / 3;
+        }
+#else
+        if (job->partCount > 0)
+        {
+            chunk->model = loadChunkModel(job->parts, job->partCount, fogShader);
+            job->parts = NULL;
+            job->partCount = 0;
+            size_t bytes = modelDataBytes(&chunk->model);
+            uploaded += bytes;
+            residentBytes += bytes;
+            residentMeshes++;
+            lodMeshes[chunk->meshLod]++;
+            lodTriangles[chunk->meshLod] += modelTriangles(&chunk->model);
+        }
+#endif
+        freeMeshJob(job);
+    }
+}
+
+void releaseChunkMesh(Chunk *chunk)
+{
+    dropChunkMesh(chunk, false);
+}
+
+MeshMemoryStats getMeshMemoryStats(void)
+{
+    MeshMemoryStats stats = {0};
+    stats.residentMeshes = residentMeshes;
+    stats.residentBytes = residentBytes;
+    stats.peakBuildBytes = getPeakMeshBuildBytes();
+    stats.skippedMeshes = skippedMeshes;
+    for (int lod = 0; lod < LOD_LEVELS; lod++)
+    {
+        stats.lod[lod].meshes = lodMeshes[lod];
+        stats.lod[lod].triangles = lodTriangles[lod];
+        stats.lod[lod].builds = lodBuilds[lod];
+        stats.lod[lod].buildMs = lodBuilds[lod] ? 1000.0 * lodBuildSeconds[lod] / lodBuilds[lod] : 0.0;
+    }
+    return stats;
+}
+
+int getPendingMeshJobs(void)
+{
+    return pendingJobs;
+}
@@ -0,0 +1,34 @@
+#ifndef MESHJOBS_H
+#define MESHJOBS_H
+
+#include "raylib.h"
+#include "chunk.h"
+#include <stddef.h>
+
+typedef struct MeshLodStats {
+    int meshes;             //Uploaded at this level
+    long long triangles;    //In those meshes
+    long long builds;       //Built at this level so far, mesh cache hits not included
+    double buildMs;         //Average worker time per build
+} MeshLodStats;
+
+typedef struct MeshMemoryStats {
+    int residentMeshes;     //Chunk meshes currently uploaded
+    size_t residentBytes;   //Size of their vertex + index data
+    size_t peakBuildBytes;  //Worst scratch + output footprint of a single chunk build
+    int skippedMeshes;      //Requests for all air or sealed solid chunks answered without a build
+    MeshLodStats lod[LOD_LEVELS]; //Per ring, see LOD_RADIUS
+} MeshMemoryStats;
+
+//Chunk meshes are built on worker threads from snapshots, only the GPU upload happens on the main thread.
+void initMeshJobs(int workerCount);
+void shutdownMeshJobs(void);
+void requestChunkMesh(int cx, int cy, int cz);
+//Uploads finished meshes, stops once MESH_UPLOAD_BUDGET_BYTES have gone up this frame
+void processMeshUploads(Shader fogShader);
+//Unloads the chunk's model and resets its mesh, keeps the memory stats in sync
+void releaseChunkMesh(Chunk *chunk);
+MeshMemoryStats getMeshMemoryStats(void);
+int getPendingMeshJobs(void);
+
+#endif
@@ -0,0 +1,179 @@
+#include "physics.h"
+#include "chunk.h"
+#include "config.h"
+#include <assert.h>
+#include <math.h>
+
+#define PHYSICS_EPSILON 0.001f //A box this close to a block's face touches it without overlapping
+//Blocks a sweep spans per axis: the body, under a block of travel and the partly covered blocks at both ends.
+//Bodies within PHYSICS_MAX_BODY_SIZE never gather more, so GATHER_MAX is never reached
+#define GATHER_SPAN ((int)PHYSICS_MAX_BODY_SIZE + 3)
+#define GATHER_MAX (GATHER_SPAN * GATHER_SPAN * GATHER_SPAN)
+
+typedef struct SolidBlocks {
+    int count;
+    int blocks[GATHER_MAX][3];
+} SolidBlocks;
+
+static SolidBlocks solids;
+
+static int floorDiv(int value, int divisor)
+{
+    return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+}
+
+PhysicsBody makeBody(Vector3 position, Vector3 size)
+{
+    assert(size.x > 0.0f && size.x <= PHYSICS_MAX_BODY_SIZE);
+    assert(size.y > 0.0f && size.y <= PHYSICS_MAX_BODY_SIZE);
+    assert(size.z > 0.0f && size.z <= PHYSICS_MAX_BODY_SIZE);
+    return (PhysicsBody){ position, (Vector3){0,0,0}, size, false };
+}
+
+int takePhysicsSteps(float *accumulator, float frameSeconds)
+{
+    *accumulator += frameSeconds;
+    int steps = (int)(*accumulator / PHYSICS_STEP);
+    if (steps > PHYSICS_MAX_STEPS)
+    {
+        *accumulator = 0.0f;
+        return PHYSICS_MAX_STEPS;
+    }
+    *accumulator -= steps * PHYSICS_STEP;
+    return steps;
+}
+
+//Every solid block overlapping [lo, hi], a chunk at a time so each is looked up once and its empty bricks skipped.
+//False when there are more than GATHER_MAX, the list is then incomplete and must not be swept against
+static bool gatherSolidBlocks(const float *lo, const float *hi, SolidBlocks *out)
+{
+    int min[3], max[3];
+    for (int a = 0; a < 3; a++)
+    {
+        min[a] = (int)floorf(lo[a]);
+        max[a] = (int)floorf(hi[a]);
+    }
+    if (min[1] < 0) min[1] = 0;
+    if (max[1] >= WORLD_HEIGHT) max[1] = WORLD_HEIGHT - 1;
+
+    out->count = 0;
+    for (int cy = min[1] / CHUNK_HEIGHT; cy <= max[1] / CHUNK_HEIGHT && min[1] <= max[1]; cy++)
+    {
+        for (int cz = floorDiv(min[2], CHUNK_WIDTH); cz <= floorDiv(max[2], CHUNK_WIDTH); cz++)
+        {
+            for (int cx = floorDiv(min[0], CHUNK_WIDTH); cx <= floorDiv(max[0], CHUNK_WIDTH); cx++)
+            {
+                Chunk *chunk = getChunk(cx, cy, cz);
+                const uint64_t *bricks = getChunkBricks(chunk);
+                int base[3] = { cx * CHUNK_WIDTH, cy * CHUNK_HEIGHT, cz * CHUNK_WIDTH };
+                int from[3], to[3];
+                for (int a = 0; a < 3; a++)
+                {
+                    int extent = (a == 1) ? CHUNK_HEIGHT : CHUNK_WIDTH;
+                    from[a] = (min[a] > base[a]) ? min[a] - base[a] : 0;
+                    to[a] = (max[a] < base[a] + extent - 1) ? max[a] - base[a] : extent - 1;
+                }
+                for (int y = from[1]; y <= to[1]; y++)
+                {
+                    for (int z = from[2]; z <= to[2]; z++)
+                    {
+                        for (int x = from[0]; x <= to[0]; x++)
+                        {
+                            if (!(bricks[y / SECTION_HEIGHT] >> BRICK_INDEX(x, y, z) & 1)) continue;
+                            if (getChunkBlock(chunk, x, y, z) == AIR) continue;
+                            if (out->count == GATHER_MAX) return false;
+                            int *block = out->blocks[out->count++];
+                            block[0] = base[0] + x;
+                            block[1] = base[1] + y;
+                            block[2] = base[2] + z;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return true;
+}
+
+//How far the box [lo, hi] gets along axis before a gathered block stops it. Blocks it only touches on the other
+//axes are passed, and one it sits in by less than PHYSICS_EPSILON pushes it back out
+static float sweepAxis(const SolidBlocks *blocks, const float *lo, const float *hi, int axis, float move)
+{
+    int b = (axis + 1) % 3, c = (axis + 2) % 3;
+    for (int i = 0; i < blocks->count; i++)
+    {
+        const int *block = blocks->blocks[i];
+        if (lo[b] >= block[b] + 1 - PHYSICS_EPSILON || hi[b] <= block[b] + PHYSICS_EPSILON) continue;
+        if (lo[c] >= block[c] + 1 - PHYSICS_EPSILON || hi[c] <= block[c] + PHYSICS_EPSILON) continue;
+
+        if (move > 0.0f && hi[axis] <= block[axis] + PHYSICS_EPSILON)
+        {
+            float limit = block[axis] - hi[axis];
+            if (limit < move) move = limit;
+        }
+        else if (move < 0.0f && lo[axis] >= block[axis] + 1 - PHYSICS_EPSILON)
+        {
+            float limit = block[axis] + 1 - lo[axis];
+            if (limit > move) move = limit;
+        }
+    }
+    return move;
+}
+
+static float clampSpeed(float speed)
+{
+    if (speed > PHYSICS_MAX_SPEED) return PHYSICS_MAX_SPEED;
+    if (speed < -PHYSICS_MAX_SPEED) return -PHYSICS_MAX_SPEED;
+    return speed;
+}
+
+static void stepBody(PhysicsBody *body, const BodyInput *input)
+{
+    float velocity[3] = { input->moveX, body->velocity.y + GRAVITY * PHYSICS_STEP, input->moveZ };
+    if (input->jump > 0.0f && body->onGround) velocity[1] = input->jump;
+
+    float position[3] = { body->position.x, body->position.y, body->position.z };
+    float half[3] = { body->size.x * 0.5f, body->size.y * 0.5f, body->size.z * 0.5f };
+    float move[3], lo[3], hi[3], sweepLo[3], sweepHi[3];
+    for (int a = 0; a < 3; a++)
+    {
+        velocity[a] = clampSpeed(velocity[a]);
+        move[a] = velocity[a] * PHYSICS_STEP;
+        lo[a] = position[a] - half[a];
+        hi[a] = position[a] + half[a];
+        sweepLo[a] = lo[a] + (move[a] < 0.0f ? move[a] : 0.0f) - PHYSICS_EPSILON;
+        sweepHi[a] = hi[a] + (move[a] > 0.0f ? move[a] : 0.0f) + PHYSICS_EPSILON;
+    }
+    //A box too big for the gather buffer would sweep past the blocks left out, so it stays where it is this step
+    if (!gatherSolidBlocks(sweepLo, sweepHi, &solids))
+    {
+        body->velocity = (Vector3){0,0,0};
+        return;
+    }
+
+    //y first, so landing and walking off an edge are settled before the sideways moves
+    static const int order[3] = { 1, 0, 2 };
+    body->onGround = false;
+    for (int i = 0; i < 3; i++)
+    {
+        int a = order[i];
+        float moved = sweepAxis(&solids, lo, hi, a, move[a]);
+        if (moved != move[a])
+        {
+            velocity[a] = 0.0f;
+            if (a == 1 && move[a] < 0.0f) body->onGround = true;
+        }
+        position[a] += moved;
+        lo[a] = position[a] - half[a];
+        hi[a] = position[a] + half[a];
+    }
+
+    body->position = (Vector3){ position[0], position[1], position[2] };
+    body->velocity = (Vector3){ velocity[0], velocity[1], velocity[2] };
+}
+
+void stepBodies(PhysicsBody *bodies, const BodyInput *inputs, int count)
+{
+    for (int i = 0; i < count; i++)
+        stepBody(&bodies[i], &inputs[i]);
+}
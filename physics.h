@@ -0,0 +1,36 @@
+#ifndef PHYSICS_H
+#define PHYSICS_H
+
+#include "raylib.h"
+#include <stdbool.h>
+
+#define GRAVITY -10.0f
+#define PHYSICS_MAX_SPEED 50.0f //Blocks per second along any axis, keeps a step's sweep under a block
+#define PHYSICS_MAX_BODY_SIZE 8.0f //Blocks along any side, sets how many voxels one sweep may gather
+
+//Axis aligned box moved in fixed steps of PHYSICS_STEP against the voxels. Bodies don't collide with each other
+typedef struct PhysicsBody {
+    Vector3 position;   //Centre of the box
+    Vector3 velocity;   //Blocks per second
+    Vector3 size;       //Full extent along x, y and z
+    bool onGround;      //The last step's fall was stopped by a block
+} PhysicsBody;
+
+//What a body wants for one step, whoever drives it (keys, AI, a recording)
+typedef struct BodyInput {
+    float moveX, moveZ; //Horizontal velocity to walk at
+    float jump;         //Upward speed to take off with if on the ground, 0 = no jump
+} BodyInput;
+
+//Size is asserted to be within PHYSICS_MAX_BODY_SIZE on every axis. A body enlarged past that afterwards is held
+//still by any step whose sweep finds more blocks than that size allows
+PhysicsBody makeBody(Vector3 position, Vector3 size);
+//Adds frameSeconds to *accumulator and takes out the whole PHYSICS_STEPs that are due. Past PHYSICS_MAX_STEPS the
+//rest is dropped, so a hitch slows the simulation down instead of snowballing
+int takePhysicsSteps(float *accumulator, float frameSeconds);
+//One PHYSICS_STEP for each body with inputs[i]. Gravity, then a swept move along y, x and z that stops at the first
+//solid block. The voxels the sweep can touch are gathered once per body. Chunks that are not resident are generated,
+//same as getBlockAtWorld. Main thread only
+void stepBodies(PhysicsBody *bodies, const BodyInput *inputs, int count);
+
+#endif
@@ -0,0 +1,222 @@
+#include "raycast.h"
+#include "chunk.h"
+#include <math.h>
+
+//Chunk the walk is in, cached so the chunk map is only searched when the ray crosses into another one
+typedef struct RayCursor {
+    bool valid;
+    int cx, cy, cz;
+    Chunk *chunk;       //NULL when not resident
+    const uint64_t *bricks;
+    bool chunkEmpty;    //Not resident or nothing but air
+} RayCursor;
+
+static int floorDiv(int value, int divisor)
+{
+    return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+}
+
+static void moveCursor(RayCursor *cursor, int cx, int cy, int cz)
+{
+    if (cursor->valid && cx == cursor->cx && cy == cursor->cy && cz == cursor->cz) return;
+
+    cursor->valid = true;
+    cursor->cx = cx;
+    cursor->cy = cy;
+    cursor->cz = cz;
+    cursor->chunk = findChunk(cx, cy, cz);
+    if (cursor->chunk != NULL && !cursor->chunk->generated) cursor->chunk = NULL;
+    cursor->bricks = cursor->chunk ? getChunkBricks(cursor->chunk) : NULL;
+    cursor->chunkEmpty = true;
+    for (int s = 0; cursor->bricks != NULL && s < CHUNK_SECTIONS; s++)
+        if (cursor->bricks[s] != 0) cursor->chunkEmpty = false;
+}
+
+static bool blockAt(RayCursor *cursor, const int *p)
+{
+    if (p[1] < 0 || p[1] >= WORLD_HEIGHT) return false;
+
+    moveCursor(cursor, floorDiv(p[0], CHUNK_WIDTH), p[1] / CHUNK_HEIGHT, floorDiv(p[2], CHUNK_WIDTH));
+    if (cursor->chunkEmpty) return false;
+    return getChunkBlock(cursor->chunk, p[0] - cursor->cx * CHUNK_WIDTH, p[1] - cursor->cy * CHUNK_HEIGHT, p[2] - cursor->cz * CHUNK_WIDTH) != AIR;
+}
+
+//Largest known empty box [lo, hi) around block p: the chunk, the section or the brick. False when p's brick holds
+//something and the blocks have to be read
+static bool findEmptyBox(RayCursor *cursor, const int *p, int *lo, int *hi)
+{
+    int cx = floorDiv(p[0], CHUNK_WIDTH), cz = floorDiv(p[2], CHUNK_WIDTH);
+    lo[0] = cx * CHUNK_WIDTH;
+    lo[2] = cz * CHUNK_WIDTH;
+    hi[0] = lo[0] + CHUNK_WIDTH;
+    hi[2] = lo[2] + CHUNK_WIDTH;
+
+    //Above or below the world only the way back in matters, one chunk's height at a time
+    if (p[1] >= WORLD_HEIGHT)
+    {
+        lo[1] = WORLD_HEIGHT;
+        hi[1] = p[1] + CHUNK_HEIGHT;
+        return true;
+    }
+    if (p[1] < 0)
+    {
+        lo[1] = p[1] - CHUNK_HEIGHT + 1;
+        hi[1] = 0;
+        return true;
+    }
+
+    int cy = p[1] / CHUNK_HEIGHT;
+    moveCursor(cursor, cx, cy, cz);
+    lo[1] = cy * CHUNK_HEIGHT;
+    hi[1] = lo[1] + CHUNK_HEIGHT;
+    if (cursor->chunkEmpty) return true;
+
+    int lx = p[0] - lo[0], ly = p[1] - lo[1], lz = p[2] - lo[2];
+    int section = ly / SECTION_HEIGHT;
+    lo[1] += section * SECTION_HEIGHT;
+    hi[1] = lo[1] + SECTION_HEIGHT;
+    if (cursor->bricks[section] == 0) return true;
+
+    if (cursor->bricks[section] >> BRICK_INDEX(lx, ly, lz) & 1) return false;
+    lo[0] += lx - lx % BRICK_SIZE;
+    lo[1] += ly % SECTION_HEIGHT - ly % BRICK_SIZE;
+    lo[2] += lz - lz % BRICK_SIZE;
+    hi[0] = lo[0] + BRICK_SIZE;
+    hi[1] = lo[1] + BRICK_SIZE;
+    hi[2] = lo[2] + BRICK_SIZE;
+    return true;
+}
+
+//Which axis the DDA steps next, ties go to z then y
+static int nextAxis(const float *tMax)
+{
+    if (tMax[0] < tMax[1]) return (tMax[0] < tMax[2]) ? 0 : 2;
+    return (tMax[1] < tMax[2]) ? 1 : 2;
+}
+
+//Whether axis a's crossing at ta comes before axis b's at tb in the order nextAxis takes them
+static bool crossesFirst(float ta, int a, float tb, int b)
+{
+    return ta < tb || (ta == tb && a > b);
+}
+
+//Every crossing the DDA makes inside an empty box lands on air, so the walk can jump to the crossing that leaves
+//the box. Each axis crosses at its own accumulated tMax values and nextAxis merges the three lists in
+//crossesFirst order, so replaying each axis alone with the same float additions ends in exactly the state the
+//voxel by voxel walk would. Returns the axis of the leaving step, or -1 when the walk passes maxDistance first
+static int skipEmptyBox(int *p, const int *step, float *tMax, const float *tDelta, float *t, float maxDistance, const int *lo, const int *hi)
+{
+    //First crossing on each axis that either leaves the box or ends the walk
+    int crossings[3];
+    float stopAt[3];
+    bool leaves[3];
+    for (int a = 0; a < 3; a++)
+    {
+        crossings[a] = (step[a] > 0) ? hi[a] - p[a] : p[a] - lo[a] + 1;
+        float at = tMax[a];
+        int k = 1;
+        while (k < crossings[a] && at <= maxDistance)
+        {
+            at += tDelta[a];
+            k++;
+        }
+        stopAt[a] = at;
+        leaves[a] = (k == crossings[a]);
+    }
+
+    int first = 0;
+    for (int a = 1; a < 3; a++)
+        if (crossesFirst(stopAt[a], a, stopAt[first], first)) first = a;
+    if (!leaves[first]) return -1;
+
+    //The other axes take every crossing before the leaving one
+    for (int a = 0; a < 3; a++)
+    {
+        if (a == first) continue;
+        while (crossesFirst(tMax[a], a, stopAt[first], first))
+        {
+            p[a] += step[a];
+            tMax[a] += tDelta[a];
+        }
+    }
+    p[first] += step[first] * crossings[first];
+    *t = stopAt[first];
+    tMax[first] = stopAt[first] + tDelta[first];
+    return first;
+}
+
+//Same steps, ties and float accumulation as a plain DDA, so the same voxels are visited and the same distances come
+//out. Only the work per voxel differs: empty boxes are crossed in one jump and chunks are looked up once
+static bool walkRay(RayCursor *cursor, Vector3 origin, Vector3 dir, float maxDistance, VoxelHit *hit)
+{
+    static const BlockFace entered[3][2] = {
+        { FACE_POS_X, FACE_NEG_X }, { FACE_POS_Y, FACE_NEG_Y }, { FACE_POS_Z, FACE_NEG_Z }
+    };
+    float o[3] = { origin.x, origin.y, origin.z };
+    float d[3] = { dir.x, dir.y, dir.z };
+    int p[3], step[3];
+    float tDelta[3], tMax[3];
+    for (int a = 0; a < 3; a++)
+    {
+        p[a] = (int)floor(o[a]);
+        step[a] = (d[a] > 0.f) ? 1 : -1;
+        tDelta[a] = (d[a] == 0.f) ? INFINITY : fabsf(1.f / d[a]);
+        tMax[a] = (d[a] > 0.f) ? ((p[a] + 1.0f) - o[a]) * tDelta[a] : (o[a] - (float)p[a]) * tDelta[a];
+    }
+
+    *hit = (VoxelHit){ false, p[0], p[1], p[2], FACE_NONE, 0.0f };
+    if (blockAt(cursor, p))
+    {
+        hit->hit = true;
+        return true;
+    }
+
+    //Above or below the world and heading away from it, nothing left to hit
+    if ((p[1] >= WORLD_HEIGHT && !(d[1] < 0.f)) || (p[1] < 0 && !(d[1] > 0.f))) return false;
+
+    //An axis parallel to a block boundary starts at 0 * infinity. nextAxis never picks that NaN, but the merge
+    //in skipEmptyBox can't order it, so those rays go voxel by voxel
+    bool canSkip = !isnan(tMax[0]) && !isnan(tMax[1]) && !isnan(tMax[2]);
+
+    float t = 0.0f;
+    while (t <= maxDistance)
+    {
+        int lo[3], hi[3];
+        int axis;
+        if (canSkip && findEmptyBox(cursor, p, lo, hi))
+        {
+            axis = skipEmptyBox(p, step, tMax, tDelta, &t, maxDistance, lo, hi);
+            if (axis < 0) return false;
+        }
+        else
+        {
+            axis = nextAxis(tMax);
+            p[axis] += step[axis];
+            t = tMax[axis];
+            tMax[axis] += tDelta[axis];
+        }
+        if ((p[1] >= WORLD_HEIGHT && step[1] > 0) || (p[1] < 0 && step[1] < 0)) return false;
+
+        if (blockAt(cursor, p))
+        {
+            *hit = (VoxelHit){ true, p[0], p[1], p[2], entered[axis][step[axis] > 0], t };
+            return true;
+        }
+    }
+    return false;
+}
+
+bool castVoxelRay(Vector3 origin, Vector3 direction, float maxDistance, VoxelHit *hit)
+{
+    RayCursor cursor = {0};
+    return walkRay(&cursor, origin, direction, maxDistance, hit);
+}
+
+int castVoxelRays(const VoxelRay *rays, int count, VoxelHit *hits)
+{
+    RayCursor cursor = {0};
+    int hitCount = 0;
+    for (int i = 0; i < count; i++)
+        hitCount += walkRay(&cursor, rays[i].origin, rays[i].direction, rays[i].maxDistance, &hits[i]);
+    return hitCount;
+}
@@ -0,0 +1,28 @@
+#ifndef RAYCAST_H
+#define RAYCAST_H
+
+#include "raylib.h"
+#include "config.h"
+#include <stdbool.h>
+
+typedef struct VoxelRay {
+    Vector3 origin;
+    Vector3 direction;  //Distances are in multiples of its length
+    float maxDistance;
+} VoxelRay;
+
+typedef struct VoxelHit {
+    bool hit;
+    int x, y, z;        //Block that stopped the ray
+    BlockFace face;     //Face the ray came in through, FACE_NONE when it starts inside the block
+    float distance;     //Along the ray where it entered the block, 0 when it starts inside
+} VoxelHit;
+
+//DDA walk to the first block that is not air. Same blocks, faces and distances as the plain per voxel DDA over
+//getBlockAtWorld, but empty chunks, sections and 4x4x4 bricks (see getChunkBricks) are crossed in one jump.
+//Chunks that are not resident count as air and are never generated. Main thread only
+bool castVoxelRay(Vector3 origin, Vector3 direction, float maxDistance, VoxelHit *hit);
+//One hit per ray, returns how many rays hit something. Coherent rays share the chunk lookups
+int castVoxelRays(const VoxelRay *rays, int count, VoxelHit *hits);
+
+#endif
@@ -0,0 +1,562 @@
+#include "region.h"
+#include "mapfile.h"
+#include "threadpool.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define REGION_MAGIC 0x47525856u //"VXRG"
+#define REGION_VERSION 1u
+#define REGION_HEADER_BYTES (8 + REGION_CHUNKS * sizeof(RegionEntry))
+#define CHUNK_ENCODED_MAX (CHUNK_SECTIONS * SECTION_ENCODED_MAX)
+
+typedef struct RegionEntry {
+    uint32_t offset; //0 = never saved
+    uint32_t size;
+} RegionEntry;
+
+typedef struct SavedChunk {
+    int rx, rz, index;
+    int sequence; //Order inside the batch, later saves of the same chunk win
+    uint32_t size;
+    uint8_t *payload;
+} SavedChunk;
+
+typedef struct SaveBatch {
+    struct SaveBatch *next;
+    SavedChunk *chunks;
+    int count;
+    int capacity;
+} SaveBatch;
+
+typedef struct RegionMap {
+    bool used;
+    bool missing; //No valid file yet, checked again after the writer touches the region
+    int rx, rz;
+    unsigned int lastUse;
+    MappedFile file;
+} RegionMap;
+
+static char *worldDirectory = NULL;
+static ThreadPool *writer = NULL;
+//Guards everything below. Loads decode under it, so the writer never invalidates a view that is being read
+static pthread_mutex_t regionLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t writtenCond = PTHREAD_COND_INITIALIZER;
+static SaveBatch *openBatch = NULL;
+//Submitted batches, oldest first. Their payloads answer loads until they are on disk
+static SaveBatch *pendingHead = NULL;
+static SaveBatch *pendingTail = NULL;
+//Saves the writer could not get on disk, oldest first. They answer loads and go out again with the next batch
+static SaveBatch *failedBatch = NULL;
+static RegionMap maps[REGION_MAPS_OPEN];
+static unsigned int mapClock = 0;
+static RegionStats stats = {0};
+
+static int floorDiv(int a, int b)
+{
+    int d = a / b;
+    if ((a ^ b) < 0 && (a % b)) d -= 1;
+    return d;
+}
+
+//Region of a chunk and its slot in that region's table
+static int regionLocation(int cx, int cy, int cz, int *rx, int *rz)
+{
+    *rx = floorDiv(cx, REGION_SIZE);
+    *rz = floorDiv(cz, REGION_SIZE);
+    int lx = cx - *rx * REGION_SIZE;
+    int lz = cz - *rz * REGION_SIZE;
+    return (cy * REGION_SIZE + lz) * REGION_SIZE + lx;
+}
+
+static void regionPath(char *path, size_t size, int rx, int rz)
+{
+    snprintf(path, size, "%s/r.%d.%d.bin", worldDirectory, rx, rz);
+}
+
+static const SavedChunk *findInBatch(const SaveBatch *batch, int rx, int rz, int index, const SavedChunk *found)
+{
+    for (int i = 0; i < batch->count; i++)
+    {
+        const SavedChunk *saved = &batch->chunks[i];
+        if (saved->rx == rx && saved->rz == rz && saved->index == index) found = saved;
+    }
+    return found;
+}
+
+static void addToBatch(SaveBatch *batch, SavedChunk saved)
+{
+    if (batch->count == batch->capacity)
+    {
+        batch->capacity = batch->capacity ? batch->capacity * 2 : 64;
+        batch->chunks = realloc(batch->chunks, batch->capacity * sizeof(SavedChunk));
+    }
+    saved.sequence = batch->count;
+    batch->chunks[batch->count++] = saved;
+}
+
+static void freeBatch(SaveBatch *batch)
+{
+    for (int i = 0; i < batch->count; i++)
+        free(batch->chunks[i].payload);
+    free(batch->chunks);
+    free(batch);
+}
+
+//Newest save of the chunk that is not on disk yet. Lock held
+static const SavedChunk *findUnwritten(int rx, int rz, int index)
+{
+    const SavedChunk *found = NULL;
+    if (failedBatch != NULL)
+        found = findInBatch(failedBatch, rx, rz, index, found);
+    for (const SaveBatch *batch = pendingHead; batch != NULL; batch = batch->next)
+        found = findInBatch(batch, rx, rz, index, found);
+    if (openBatch != NULL)
+        found = findInBatch(openBatch, rx, rz, index, found);
+    return found;
+}
+
+static void closeRegionMap(RegionMap *map)
+{
+    unmapFile(&map->file);
+    map->used = false;
+}
+
+//Mapped view of the region, opening it over the least recently used one. Lock held
+static RegionMap *getRegionMap(int rx, int rz)
+{
+    RegionMap *slot = NULL;
+    for (int i = 0; i < REGION_MAPS_OPEN; i++)
+    {
+        if (maps[i].used && maps[i].rx == rx && maps[i].rz == rz)
+        {
+            maps[i].lastUse = ++mapClock;
+            return &maps[i];
+        }
+        if (slot == NULL || !maps[i].used || (slot->used && maps[i].lastUse < slot->lastUse))
+            slot = &maps[i];
+    }
+
+    closeRegionMap(slot);
+    slot->used = true;
+    slot->rx = rx;
+    slot->rz = rz;
+    slot->lastUse = ++mapClock;
+
+    char path[512];
+    regionPath(path, sizeof(path), rx, rz);
+    slot->missing = !mapFile(&slot->file, path);
+    if (!slot->missing)
+    {
+        uint32_t header[2] = {0};
+        if (slot->file.size >= REGION_HEADER_BYTES) memcpy(header, slot->file.data, sizeof(header));
+        if (header[0] != REGION_MAGIC || header[1] != REGION_VERSION)
+        {
+            unmapFile(&slot->file);
+            slot->missing = true;
+        }
+    }
+    return slot;
+}
+
+//Drops the view of a region the writer just changed. Lock held
+static void invalidateRegionMap(int rx, int rz)
+{
+    for (int i = 0; i < REGION_MAPS_OPEN; i++)
+        if (maps[i].used && maps[i].rx == rx && maps[i].rz == rz)
+            closeRegionMap(&maps[i]);
+}
+
+static bool decodeChunk(Chunk *chunk, const uint8_t *payload, size_t size)
+{
+    size_t offset = 0;
+    for (int s = 0; s < CHUNK_SECTIONS; s++)
+    {
+        size_t used = decodeSection(&chunk->sections[s], payload + offset, size - offset);
+        if (used == 0) return false;
+        offset += used;
+    }
+    return offset == size;
+}
+
+void initRegions(const char *directory)
+{
+    if (worldDirectory != NULL) return;
+    //Without a directory saves would only look like they worked, edited chunks stay in memory instead
+    if (!makeDirectory(directory))
+    {
+        printf("Could not create %s, the world will not be saved\n", directory);
+        return;
+    }
+    worldDirectory = malloc(strlen(directory) + 1);
+    strcpy(worldDirectory, directory);
+    writer = createThreadPool(1);
+    stats = (RegionStats){0};
+}
+
+void shutdownRegions(void)
+{
+    if (worldDirectory == NULL) return;
+    //Earlier failures get one more try even without new saves
+    pthread_mutex_lock(&regionLock);
+    if (failedBatch != NULL && openBatch == NULL) openBatch = calloc(1, sizeof(SaveBatch));
+    pthread_mutex_unlock(&regionLock);
+    submitRegionWrites();
+    //Runs every queued batch before joining
+    destroyThreadPool(writer);
+    writer = NULL;
+    if (failedBatch != NULL)
+    {
+        printf("%d edited chunks could not be saved\n", failedBatch->count);
+        freeBatch(failedBatch);
+        failedBatch = NULL;
+    }
+    for (int i = 0; i < REGION_MAPS_OPEN; i++)
+        closeRegionMap(&maps[i]);
+    free(worldDirectory);
+    worldDirectory = NULL;
+}
+
+bool loadChunkFromRegion(Chunk *chunk, int cx, int cy, int cz)
+{
+    if (worldDirectory == NULL) return false;
+
+    int rx, rz;
+    int index = regionLocation(cx, cy, cz, &rx, &rz);
+    bool loaded = false;
+    pthread_mutex_lock(&regionLock);
+    const SavedChunk *saved = findUnwritten(rx, rz, index);
+    if (saved != NULL)
+    {
+        loaded = decodeChunk(chunk, saved->payload, saved->size);
+    }
+    else
+    {
+        RegionMap *map = getRegionMap(rx, rz);
+        if (!map->missing)
+        {
+            RegionEntry entry;
+            memcpy(&entry, map->file.data + 8 + index * sizeof(RegionEntry), sizeof(entry));
+            if (entry.offset != 0 && (size_t)entry.offset + entry.size <= map->file.size)
+                loaded = decodeChunk(chunk, map->file.data + entry.offset, entry.size);
+        }
+    }
+    if (loaded) stats.chunksLoaded++;
+    pthread_mutex_unlock(&regionLock);
+
+    if (!loaded) return false;
+    chunk->model = (Model){0};
+    chunk->generated = true;
+    chunk->modified = false;
+    return true;
+}
+
+bool saveChunkToRegion(Chunk *chunk)
+{
+    if (worldDirectory == NULL) return false;
+
+    uint8_t buffer[CHUNK_ENCODED_MAX];
+    size_t size = 0;
+    for (int s = 0; s < CHUNK_SECTIONS; s++)
+        size += encodeSection(&chunk->sections[s], buffer + size);
+
+    SavedChunk saved;
+    saved.index = regionLocation(chunk->cx, chunk->cy, chunk->cz, &saved.rx, &saved.rz);
+    saved.size = (uint32_t)size;
+    saved.payload = malloc(size);
+    memcpy(saved.payload, buffer, size);
+
+    pthread_mutex_lock(&regionLock);
+    if (openBatch == NULL) openBatch = calloc(1, sizeof(SaveBatch));
+    addToBatch(openBatch, saved);
+    stats.pendingWrites++;
+    pthread_mutex_unlock(&regionLock);
+
+    chunk->modified = false;
+    return true;
+}
+
+//Region file open on the writer thread, with its table and which sectors the table points at
+typedef struct RegionWriter {
+    FILE *file;
+    RegionEntry *table;     //REGION_CHUNKS entries, read once per batch
+    uint8_t *sectorUsed;    //One per sector, header included
+    uint32_t sectorCount;   //Sectors up to the end of the last payload, or of the file
+    uint32_t sectorCapacity;
+} RegionWriter;
+
+#define REGION_HEADER_SECTORS ((uint32_t)((REGION_HEADER_BYTES + REGION_SECTOR_BYTES - 1) / REGION_SECTOR_BYTES))
+
+static uint32_t sectorsFor(uint32_t bytes)
+{
+    return (bytes + REGION_SECTOR_BYTES - 1) / REGION_SECTOR_BYTES;
+}
+
+static void markSectors(RegionWriter *writer, uint32_t first, uint32_t count, bool used)
+{
+    if (first + count > writer->sectorCapacity)
+    {
+        uint32_t capacity = writer->sectorCapacity ? writer->sectorCapacity : 64;
+        while (capacity < first + count) capacity *= 2;
+        writer->sectorUsed = realloc(writer->sectorUsed, capacity);
+        memset(writer->sectorUsed + writer->sectorCapacity, 0, capacity - writer->sectorCapacity);
+        writer->sectorCapacity = capacity;
+    }
+    memset(writer->sectorUsed + first, used, count);
+    if (used && first + count > writer->sectorCount) writer->sectorCount = first + count;
+}
+
+//First free run of count sectors, a free run at the end is extended past it
+static uint32_t allocateSectors(RegionWriter *writer, uint32_t count)
+{
+    uint32_t run = 0;
+    for (uint32_t s = REGION_HEADER_SECTORS; s < writer->sectorCount; s++)
+    {
+        run = writer->sectorUsed[s] ? 0 : run + 1;
+        if (run == count) return s + 1 - count;
+    }
+    return writer->sectorCount - run;
+}
+
+static bool closeRegionFile(RegionWriter *writer)
+{
+    bool closed = fclose(writer->file) == 0;
+    free(writer->table);
+    free(writer->sectorUsed);
+    return closed;
+}
+
+static bool openRegionFile(int rx, int rz, RegionWriter *writer)
+{
+    char path[512];
+    regionPath(path, sizeof(path), rx, rz);
+    *writer = (RegionWriter){0};
+    writer->table = calloc(REGION_CHUNKS, sizeof(RegionEntry));
+
+    uint32_t magic[2] = {0};
+    writer->file = fopen(path, "r+b");
+    bool valid = writer->file != NULL && fread(magic, sizeof(magic), 1, writer->file) == 1
+        && magic[0] == REGION_MAGIC && magic[1] == REGION_VERSION
+        && fread(writer->table, sizeof(RegionEntry), REGION_CHUNKS, writer->file) == REGION_CHUNKS;
+    if (!valid)
+    {
+        //New file, or one loads ignore anyway: header and an empty table, padded to the first sector
+        if (writer->file != NULL) fclose(writer->file);
+        writer->file = fopen(path, "w+b");
+        memset(writer->table, 0, REGION_CHUNKS * sizeof(RegionEntry));
+        size_t headerBytes = (size_t)REGION_HEADER_SECTORS * REGION_SECTOR_BYTES;
+        uint8_t *header = calloc(headerBytes, 1);
+        magic[0] = REGION_MAGIC;
+        magic[1] = REGION_VERSION;
+        memcpy(header, magic, sizeof(magic));
+        if (writer->file != NULL && fwrite(header, 1, headerBytes, writer->file) != headerBytes)
+        {
+            fclose(writer->file);
+            writer->file = NULL;
+        }
+        free(header);
+        if (writer->file == NULL)
+        {
+            free(writer->table);
+            return false;
+        }
+    }
+
+    //Everything the table doesn't point at is free, including what earlier moves left behind. Entries past the end
+    //are ignored like loads ignore them
+    if (fseek(writer->file, 0, SEEK_END) != 0)
+    {
+        closeRegionFile(writer);
+        return false;
+    }
+    long fileBytes = ftell(writer->file);
+    markSectors(writer, 0, REGION_HEADER_SECTORS, true);
+    for (int i = 0; i < REGION_CHUNKS; i++)
+    {
+        RegionEntry *entry = &writer->table[i];
+        if (entry->offset == 0) continue;
+        if ((long long)entry->offset + entry->size <= fileBytes)
+            markSectors(writer, entry->offset / REGION_SECTOR_BYTES, sectorsFor(entry->size), true);
+        else
+            *entry = (RegionEntry){0};
+    }
+    return true;
+}
+
+//Rewrites in place when the payload still fits its sectors, otherwise into the first free run. Sectors it leaves are
+//free for the next writes, a moved payload's only once the table points away from them. False if any write failed
+static bool writeSavedChunk(RegionWriter *writer, const SavedChunk *saved)
+{
+    static const uint8_t padding[REGION_SECTOR_BYTES] = {0};
+    RegionEntry entry = writer->table[saved->index];
+    uint32_t sectors = sectorsFor(saved->size);
+    uint32_t oldFirst = entry.offset / REGION_SECTOR_BYTES;
+    uint32_t oldSectors = sectorsFor(entry.size);
+    bool inPlace = entry.offset != 0 && sectors <= oldSectors;
+    uint32_t first = inPlace ? oldFirst : allocateSectors(writer, sectors);
+    markSectors(writer, first, sectors, true);
+
+    entry.offset = first * REGION_SECTOR_BYTES;
+    entry.size = saved->size;
+    size_t paddingBytes = sectors * REGION_SECTOR_BYTES - saved->size;
+    long entryOffset = 8 + saved->index * (long)sizeof(RegionEntry);
+    bool written = fseek(writer->file, entry.offset, SEEK_SET) == 0
+        && fwrite(saved->payload, 1, saved->size, writer->file) == saved->size
+        && fwrite(padding, 1, paddingBytes, writer->file) == paddingBytes
+        && fseek(writer->file, entryOffset, SEEK_SET) == 0
+        && fwrite(&entry, sizeof(entry), 1, writer->file) == 1;
+    if (!written)
+    {
+        if (!inPlace) markSectors(writer, first, sectors, false);
+        return false;
+    }
+
+    if (inPlace) markSectors(writer, first + sectors, oldSectors - sectors, false);
+    else if (oldSectors > 0) markSectors(writer, oldFirst, oldSectors, false);
+    writer->table[saved->index] = entry;
+    return true;
+}
+
+static int compareSaved(const void *a, const void *b)
+{
+    const SavedChunk *sa = a, *sb = b;
+    if (sa->rx != sb->rx) return sa->rx < sb->rx ? -1 : 1;
+    if (sa->rz != sb->rz) return sa->rz < sb->rz ? -1 : 1;
+    return sa->sequence - sb->sequence;
+}
+
+//Writer thread: one open per region in the batch, then the batch stops answering loads. Saves that did not make it
+//to disk keep their payloads in failedBatch, so no edit is lost with them
+static void writeBatch(void *arg)
+{
+    SaveBatch *batch = arg;
+    SavedChunk *sorted = malloc(batch->count * sizeof(SavedChunk));
+    memcpy(sorted, batch->chunks, batch->count * sizeof(SavedChunk));
+    qsort(sorted, batch->count, sizeof(SavedChunk), compareSaved);
+    bool *written = calloc(batch->count, sizeof(bool));
+
+    size_t bytes = 0;
+    int writtenCount = 0;
+    for (int first = 0; first < batch->count; )
+    {
+        int last = first;
+        while (last < batch->count && sorted[last].rx == sorted[first].rx && sorted[last].rz == sorted[first].rz) last++;
+
+        RegionWriter region;
+        if (openRegionFile(sorted[first].rx, sorted[first].rz, &region))
+        {
+            for (int i = first; i < last; i++)
+                written[i] = writeSavedChunk(&region, &sorted[i]);
+            //Nothing counts as saved if the buffered writes could not be flushed
+            if (!closeRegionFile(&region))
+                for (int i = first; i < last; i++) written[i] = false;
+        }
+        int regionWritten = 0;
+        for (int i = first; i < last; i++)
+        {
+            if (!written[i]) continue;
+            bytes += sorted[i].size;
+            regionWritten++;
+        }
+        writtenCount += regionWritten;
+        if (regionWritten < last - first)
+            printf("Could not write region %d,%d, unsaved chunks are kept for the next save\n", sorted[first].rx, sorted[first].rz);
+
+        pthread_mutex_lock(&regionLock);
+        invalidateRegionMap(sorted[first].rx, sorted[first].rz);
+        pthread_mutex_unlock(&regionLock);
+        first = last;
+    }
+
+    //Batches run in submit order on the single writer, so this one is the head
+    pthread_mutex_lock(&regionLock);
+    for (int i = 0; i < batch->count; i++)
+    {
+        if (written[i])
+        {
+            free(sorted[i].payload);
+            continue;
+        }
+        if (failedBatch == NULL) failedBatch = calloc(1, sizeof(SaveBatch));
+        addToBatch(failedBatch, sorted[i]);
+        stats.failedWrites++;
+    }
+    pendingHead = batch->next;
+    if (pendingHead == NULL) pendingTail = NULL;
+    stats.pendingWrites -= writtenCount;
+    stats.chunksSaved += writtenCount;
+    stats.bytesWritten += bytes;
+    pthread_cond_broadcast(&writtenCond);
+    pthread_mutex_unlock(&regionLock);
+
+    free(written);
+    free(sorted);
+    free(batch->chunks);
+    free(batch);
+}
+
+//Puts the failed saves in front of batch, oldest first. One with a newer save already on its way is dropped so it
+//can't overwrite that one on disk. Lock held
+static void requeueFailed(SaveBatch *batch)
+{
+    SaveBatch *merged = calloc(1, sizeof(SaveBatch));
+    for (int i = 0; i < failedBatch->count; i++)
+    {
+        SavedChunk *saved = &failedBatch->chunks[i];
+        const SavedChunk *newer = findInBatch(batch, saved->rx, saved->rz, saved->index, NULL);
+        for (const SaveBatch *pending = pendingHead; pending != NULL && newer == NULL; pending = pending->next)
+            newer = findInBatch(pending, saved->rx, saved->rz, saved->index, NULL);
+        if (newer != NULL)
+        {
+            free(saved->payload);
+            stats.pendingWrites--;
+        }
+        else addToBatch(merged, *saved);
+    }
+    for (int i = 0; i < batch->count; i++)
+        addToBatch(merged, batch->chunks[i]);
+
+    free(batch->chunks);
+    *batch = *merged;
+    free(merged);
+    free(failedBatch->chunks);
+    free(failedBatch);
+    failedBatch = NULL;
+}
+
+void submitRegionWrites(void)
+{
+    if (worldDirectory == NULL) return;
+
+    pthread_mutex_lock(&regionLock);
+    SaveBatch *batch = openBatch;
+    openBatch = NULL;
+    //Failed saves are retried along with new ones rather than every frame
+    if (batch != NULL && failedBatch != NULL) requeueFailed(batch);
+    if (batch != NULL)
+    {
+        if (pendingTail != NULL) pendingTail->next = batch;
+        else pendingHead = batch;
+        pendingTail = batch;
+    }
+    pthread_mutex_unlock(&regionLock);
+
+    if (batch != NULL) submitJob(writer, writeBatch, batch);
+}
+
+void flushRegionWrites(void)
+{
+    pthread_mutex_lock(&regionLock);
+    while (pendingHead != NULL)
+        pthread_cond_wait(&writtenCond, &regionLock);
+    pthread_mutex_unlock(&regionLock);
+}
+
+RegionStats getRegionStats(void)
+{
+    pthread_mutex_lock(&regionLock);
+    RegionStats copy = stats;
+    pthread_mutex_unlock(&regionLock);
+    return copy;
+}
@@ -0,0 +1,42 @@
+#ifndef REGION_H
+#define REGION_H
+
+#include "chunk.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+//Region files hold REGION_SIZE x REGION_SIZE columns, every layer, named r.<rx>.<rz>.bin in the world directory.
+//Layout: magic, version, one {offset, size} entry per chunk, then the chunk payloads on REGION_SECTOR_BYTES
+//boundaries. A payload is its sections back to back in encodeSection form. Little endian, as written by the host.
+//Sectors a payload leaves when it moves or shrinks are reused by later writes instead of growing the file
+#define REGION_SIZE 32
+#define REGION_CHUNKS (REGION_SIZE * REGION_SIZE * WORLD_HEIGHT_CHUNKS)
+#define REGION_SECTOR_BYTES 256
+#define REGION_MAPS_OPEN 16 //Region files kept mapped at once, least recently used is closed first
+
+typedef struct RegionStats {
+    int pendingWrites;      //Chunks encoded but not on disk yet
+    long long chunksSaved;
+    long long chunksLoaded;
+    size_t bytesWritten;    //Payload bytes
+    long long failedWrites; //Saves the writer could not get on disk, they stay pending and are retried
+} RegionStats;
+
+//Starts the writer thread. Until this is called nothing is loaded or saved, and nothing is if the directory can't
+//be created: saveChunkToRegion then returns false and edited chunks stay in memory
+void initRegions(const char *directory);
+//Writes everything still queued, then stops the writer and closes the files
+void shutdownRegions(void);
+//Fills a fresh chunk from its region file, or from a save still in the queue. False if it was never saved.
+//Safe from the generation workers
+bool loadChunkFromRegion(Chunk *chunk, int cx, int cy, int cz);
+//Encodes the chunk now and clears modified, the file is written on the writer thread after submitRegionWrites.
+//False if regions are not running, the chunk is left as is
+bool saveChunkToRegion(Chunk *chunk);
+//Hands the saves made since the last call to the writer as one batch
+void submitRegionWrites(void);
+//Blocks until the writer has caught up
+void flushRegionWrites(void);
+RegionStats getRegionStats(void);
+
+#endif
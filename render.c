@@ -0,0 +1,150 @@
+#include "render.h"
+#include "config.h"
+#include "rlgl.h"
+#include "raymath.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+static Shader packedShader = {0};
+
+RenderTexture2D loadSceneTarget(int pixelSize)
+{
+    int width = (SCREEN_WIDTH + pixelSize - 1) / pixelSize;
+    int height = (SCREEN_HEIGHT + pixelSize - 1) / pixelSize;
+    RenderTexture2D target = LoadRenderTexture(width, height);
+    SetTextureFilter(target.texture, TEXTURE_FILTER_POINT);
+    return target;
+}
+
+void drawSceneTarget(RenderTexture2D target, int pixelSize)
+{
+    //Render textures come out upside down, flip the source
+    float width = (float)target.texture.width;
+    float height = (float)target.texture.height;
+    DrawTexturePro(target.texture, (Rectangle){ 0, 0, width, -height }, (Rectangle){ 0, 0, width * pixelSize, height * pixelSize },
+        (Vector2){ 0, 0 }, 0.0f, WHITE);
+}
+
+//Shader source with FOG_MODE defined right after the #version line, which has to stay first. Freed with MemFree
+static char *loadFogVariant(const char *path, int fogQuality)
+{
+    char *source = LoadFileText(path);
+    char *lineEnd = source ? strchr(source, '\n') : NULL;
+    if (lineEnd == NULL) return source;
+
+    char define[32];
+    int defineLength = snprintf(define, sizeof(define), "#define FOG_MODE %d\n", fogQuality);
+    size_t head = (size_t)(lineEnd - source) + 1;
+    size_t tail = strlen(lineEnd + 1) + 1;
+
+    char *variant = MemAlloc(head + defineLength + tail);
+    memcpy(variant, source, head);
+    memcpy(variant + head, define, defineLength);
+    memcpy(variant + head + defineLength, lineEnd + 1, tail);
+    UnloadFileText(source);
+    return variant;
+}
+
+Shader loadFogShader(const char *vsPath, int fogQuality)
+{
+    char *vsCode = loadFogVariant(vsPath, fogQuality);
+    char *fsCode = loadFogVariant("shader/fog.fs", fogQuality);
+    Shader shader = LoadShaderFromMemory(vsCode, fsCode);
+    MemFree(vsCode);
+    MemFree(fsCode);
+
+    shader.locs[SHADER_LOC_VECTOR_VIEW] = GetShaderLocation(shader, "viewPos");
+    shader.locs[SHADER_LOC_MATRIX_MODEL] = GetShaderLocation(shader, "matModel");
+    Vector4 sky = ColorNormalize(SKY_COLOR);
+    SetShaderValue(shader, GetShaderLocation(shader, "fogColor"), &sky, SHADER_UNIFORM_VEC3);
+    return shader;
+}
+
+Model loadChunkModel(Mesh *parts, int partCount, Shader shader)
+{
+    //Same layout LoadModelFromMesh builds, but with one mesh per part
+    Model model = {0};
+    model.transform = MatrixIdentity();
+    model.meshCount = partCount;
+    model.meshes = parts;
+    model.materialCount = 1;
+    model.materials = MemAlloc(sizeof(Material));
+    model.materials[0] = LoadMaterialDefault();
+    model.materials[0].shader = shader;
+    model.meshMaterial = MemAlloc(partCount * sizeof(int)); //All zero, the one material
+
+    for (int m = 0; m < partCount; m++)
+        UploadMesh(&model.meshes[m], false);
+    return model;
+}
+
+void loadPackedBuffer(const uint8_t *vertices, int vertexCount, bool dynamic, unsigned int *vaoId, unsigned int *vboId)
+{
+    *vaoId = rlLoadVertexArray();
+    rlEnableVertexArray(*vaoId);
+
+    //Bytes are not normalized so the shader sees the block coordinates and face index as whole floats
+    *vboId = rlLoadVertexBuffer(vertices, vertexCount * PACKED_VERTEX_SIZE, dynamic);
+    rlSetVertexAttribute(0, 4, RL_UNSIGNED_BYTE, false, 0, 0);
+    rlEnableVertexAttribute(0);
+
+    rlDisableVertexArray();
+}
+
+void unloadPackedBuffer(unsigned int vaoId, unsigned int vboId)
+{
+    rlUnloadVertexArray(vaoId);
+    rlUnloadVertexBuffer(vboId);
+}
+
+void uploadPackedMesh(PackedMesh *mesh)
+{
+    loadPackedBuffer(mesh->vertices, mesh->vertexCount, false, &mesh->vaoId, &mesh->vboId);
+
+    //Nothing reads the CPU copy after upload
+    MemFree(mesh->vertices);
+    mesh->vertices = NULL;
+}
+
+void unloadPackedMesh(PackedMesh *mesh)
+{
+    if (mesh->vaoId != 0)
+        unloadPackedBuffer(mesh->vaoId, mesh->vboId);
+    MemFree(mesh->vertices);
+    *mesh = (PackedMesh){0};
+}
+
+void beginPackedDraw(Shader shader, Color tint)
+{
+    packedShader = shader;
+    rlEnableShader(shader.id);
+
+    //Same inputs fog.fs gets from DrawModel: the default white texture and the tint as colDiffuse
+    float diffuse[4] = { tint.r / 255.0f, tint.g / 255.0f, tint.b / 255.0f, tint.a / 255.0f };
+    rlSetUniform(shader.locs[SHADER_LOC_COLOR_DIFFUSE], diffuse, RL_SHADER_UNIFORM_VEC4, 1);
+    rlActiveTextureSlot(0);
+    rlEnableTexture(rlGetTextureIdDefault());
+}
+
+void setPackedDrawPosition(Vector3 position)
+{
+    Matrix model = MatrixTranslate(position.x, position.y, position.z);
+    Matrix mvp = MatrixMultiply(MatrixMultiply(model, rlGetMatrixModelview()), rlGetMatrixProjection());
+    rlSetUniformMatrix(packedShader.locs[SHADER_LOC_MATRIX_MVP], mvp);
+    rlSetUniformMatrix(packedShader.locs[SHADER_LOC_MATRIX_MODEL], model);
+}
+
+void drawPackedMesh(const PackedMesh *mesh, Vector3 position)
+{
+    setPackedDrawPosition(position);
+    rlEnableVertexArray(mesh->vaoId);
+    rlDrawVertexArray(0, mesh->vertexCount);
+    rlDisableVertexArray();
+}
+
+void endPackedDraw(void)
+{
+    rlDisableTexture();
+    rlDisableShader();
+}
@@ -0,0 +1,44 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+#include "raylib.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PACKED_VERTEX_SIZE 4
+#define PACKED_VERTICES_PER_QUAD 6
+
+//Compact chunk mesh for CHUNK_PACKED_VERTICES, one 4 byte vertex instead of 36 bytes of floats and colors
+typedef struct PackedMesh {
+    int vertexCount;            //Non-indexed, PACKED_VERTICES_PER_QUAD per quad
+    uint8_t *vertices;          //x, y, z, face per vertex, freed after upload
+    unsigned int vaoId;
+    unsigned int vboId;
+} PackedMesh;
+
+//Target for the 3D pass, one texel per pixelSize x pixelSize screen pixels (rounded up to cover the screen)
+RenderTexture2D loadSceneTarget(int pixelSize);
+//Stretches the target over the screen without filtering, so every texel becomes a sharp block
+void drawSceneTarget(RenderTexture2D target, int pixelSize);
+
+//Chunk shader: vsPath with shader/fog.fs, both compiled for fogQuality (FOG_OFF, FOG_PER_VERTEX or FOG_PER_FRAGMENT).
+//Sets the view and model locations and the fog colour, fogDensity is left to the caller
+Shader loadFogShader(const char *vsPath, int fogQuality);
+
+//Uploads every part and wraps them in one model sharing a single material, the model owns parts afterwards
+Model loadChunkModel(Mesh *parts, int partCount, Shader shader);
+
+void uploadPackedMesh(PackedMesh *mesh);
+void unloadPackedMesh(PackedMesh *mesh);
+//Vertex array + buffer for vertexCount packed vertices. Dynamic buffers are meant to be patched with rlUpdateVertexBuffer
+void loadPackedBuffer(const uint8_t *vertices, int vertexCount, bool dynamic, unsigned int *vaoId, unsigned int *vboId);
+void unloadPackedBuffer(unsigned int vaoId, unsigned int vboId);
+
+//Packed meshes bypass DrawModel, so shader state is set once per frame around the chunk draws
+void beginPackedDraw(Shader shader, Color tint);
+void drawPackedMesh(const PackedMesh *mesh, Vector3 position);
+//Model and mvp matrices for the draws that follow, for callers that draw ranges of a shared buffer themselves
+void setPackedDrawPosition(Vector3 position);
+void endPackedDraw(void);
+
+#endif
@@ -0,0 +1,101 @@
+#include "renderdistance.h"
+#include "chunk.h"
+#include "config.h"
+#include <stdio.h>
+
+//A step out is only taken when the frame time it predicts stays under GROW_TO, well clear of SHRINK_AT, so the next
+//window does not undo it. Near the default distance that is growing below about 0.75 of the budget
+#define RENDER_DISTANCE_GROW_TO 0.9f
+#define RENDER_DISTANCE_SHRINK_AT 1.1f
+#define RENDER_DISTANCE_HITCH 4.0f //Budgets one frame may count for, so a save or the first frame after loading can't decide a window alone
+
+static double windowSum = 0.0;
+static int windowFrames = 0;
+static int lastDirection = 0;
+static RenderDistanceStats stats = {0};
+
+void initRenderDistance(void)
+{
+    currentRenderDistance = DEFAULT_RENDER_DISTANCE;
+    currentLodRadius = LOD_RADIUS;
+    windowSum = 0.0;
+    windowFrames = 0;
+    lastDirection = 0;
+    stats = (RenderDistanceStats){0};
+}
+
+//Distance goes first both ways, the LOD radius is only traded once the distance is down to its minimum.
+//A radius at or past the distance makes no difference, so those steps are skipped
+static bool stepRenderDistance(int direction)
+{
+    if (direction < 0)
+    {
+        int lodRadius = (currentLodRadius < currentRenderDistance) ? currentLodRadius : currentRenderDistance;
+        if (currentRenderDistance > RENDER_DISTANCE_MIN) currentRenderDistance--;
+        else if (lodRadius > LOD_RADIUS_MIN) currentLodRadius = lodRadius - 1;
+        else return false;
+    }
+    else
+    {
+        if (currentLodRadius < LOD_RADIUS)
+            currentLodRadius = (currentLodRadius + 1 < currentRenderDistance) ? currentLodRadius + 1 : LOD_RADIUS;
+        else if (currentRenderDistance < RENDER_DISTANCE_MAX) currentRenderDistance++;
+        else return false;
+    }
+    return true;
+}
+
+//Frame cost after the next step out over the cost now, taken as the ratio of the columns that get more expensive.
+//Far columns and the fixed part of a frame grow less than that, so the guess errs on the safe side. One step costs
+//about 20% near the default distance but close to twice as much near RENDER_DISTANCE_MIN
+static float growthCostRatio(void)
+{
+    int radius = currentRenderDistance;
+    if (currentLodRadius < LOD_RADIUS && currentLodRadius < currentRenderDistance) radius = currentLodRadius;
+    float side = 2.0f * radius + 1.0f;
+    return (side + 2.0f) * (side + 2.0f) / (side * side);
+}
+
+bool updateRenderDistance(float frameSeconds, int backlog)
+{
+    //Frames spent loading say little about what the distance costs once loaded, and the window starts over after
+    //every step so the next decision only sees the new distance
+    if (backlog > RENDER_DISTANCE_BACKLOG)
+    {
+        windowSum = 0.0;
+        windowFrames = 0;
+        return false;
+    }
+    float frameMs = frameSeconds * 1000.0f;
+    if (frameMs > FRAME_BUDGET_MS * RENDER_DISTANCE_HITCH) frameMs = FRAME_BUDGET_MS * RENDER_DISTANCE_HITCH;
+    windowSum += frameMs;
+    if (++windowFrames < RENDER_DISTANCE_WINDOW) return false;
+
+    float average = (float)(windowSum / windowFrames);
+    stats.averageMs = average;
+    windowSum = 0.0;
+    windowFrames = 0;
+
+    int direction = 0;
+    if (average > FRAME_BUDGET_MS * RENDER_DISTANCE_SHRINK_AT) direction = -1;
+    else if (average * growthCostRatio() < FRAME_BUDGET_MS * RENDER_DISTANCE_GROW_TO) direction = 1;
+    if (direction == 0) return false;
+
+    int oldDistance = currentRenderDistance;
+    int oldLodRadius = currentLodRadius;
+    if (!stepRenderDistance(direction)) return false;
+
+    stats.changes++;
+    if (lastDirection != 0 && direction != lastDirection) stats.reversals++;
+    lastDirection = direction;
+    printf("Render distance %d -> %d, LOD radius %d -> %d (%.2f ms average frame, budget %.2f ms, backlog %d)\n",
+        oldDistance, currentRenderDistance, oldLodRadius, currentLodRadius, average, FRAME_BUDGET_MS, backlog);
+    return true;
+}
+
+RenderDistanceStats getRenderDistanceStats(void)
+{
+    stats.renderDistance = currentRenderDistance;
+    stats.lodRadius = currentLodRadius;
+    return stats;
+}
@@ -0,0 +1,23 @@
+#ifndef RENDERDISTANCE_H
+#define RENDERDISTANCE_H
+
+#include <stdbool.h>
+
+//Feedback loop that moves currentRenderDistance (and past its minimum, currentLodRadius) one step at a time to keep
+//the rolling frame time inside FRAME_BUDGET_MS. Main thread only
+typedef struct RenderDistanceStats {
+    float averageMs;    //Of the last full window, 0 before the first one
+    int renderDistance;
+    int lodRadius;
+    int changes;        //Steps taken so far, either way
+    int reversals;      //Steps in the opposite direction of the one before
+} RenderDistanceStats;
+
+//Starts over from DEFAULT_RENDER_DISTANCE and LOD_RADIUS
+void initRenderDistance(void);
+//Feeds one frame. backlog is the chunk loads and mesh builds still outstanding. Returns true when the distance or
+//LOD radius changed, the caller then runs updateVisibleChunks so the square and the levels follow
+bool updateRenderDistance(float frameSeconds, int backlog);
+RenderDistanceStats getRenderDistanceStats(void);
+
+#endif
@@ -0,0 +1,239 @@
+#include "section.h"
+#include <stdlib.h>
+#include <string.h>
+
+static size_t packedBytes(int bits)
+{
+    return (size_t)SECTION_VOLUME * bits / 8;
+}
+
+static int bitsForPalette(int paletteSize)
+{
+    if (paletteSize <= 2) return 1;
+    if (paletteSize <= 4) return 2;
+    return 4;
+}
+
+static int getPaletteIndex(const ChunkSection *section, int idx)
+{
+    int bit = idx * section->bits;
+    return (section->data[bit >> 3] >> (bit & 7)) & ((1 << section->bits) - 1);
+}
+
+static void setPaletteIndex(ChunkSection *section, int idx, int paletteIndex)
+{
+    int bit = idx * section->bits;
+    uint8_t mask = (uint8_t)(((1 << section->bits) - 1) << (bit & 7));
+    section->data[bit >> 3] = (uint8_t)((section->data[bit >> 3] & ~mask) | (paletteIndex << (bit & 7)));
+}
+
+//Widen palette indices in place of the old array, keeps palette entries as is
+static void repackPalette(ChunkSection *section, int newBits)
+{
+    ChunkSection old = *section;
+    section->bits = (uint8_t)newBits;
+    section->data = calloc(packedBytes(newBits), 1);
+    for (int idx = 0; idx < SECTION_VOLUME; idx++)
+        setPaletteIndex(section, idx, getPaletteIndex(&old, idx));
+    free(old.data);
+}
+
+static void convertToBytes(ChunkSection *section)
+{
+    uint8_t *raw = malloc(SECTION_VOLUME);
+    unpackSection(section, raw);
+    free(section->data);
+    section->storage = SECTION_BYTES;
+    section->bits = 8;
+    section->data = raw;
+}
+
+void initSection(ChunkSection *section, uint8_t value)
+{
+    memset(section, 0, sizeof(*section));
+    section->storage = SECTION_UNIFORM;
+    section->paletteSize = 1;
+    section->palette[0] = value;
+}
+
+void freeSection(ChunkSection *section)
+{
+    free(section->data);
+    section->data = NULL;
+}
+
+uint8_t getSectionBlock(const ChunkSection *section, int x, int y, int z)
+{
+    int idx = SECTION_INDEX(x, y, z);
+    switch (section->storage)
+    {
+        case SECTION_UNIFORM: return section->palette[0];
+        case SECTION_PALETTE: return section->palette[getPaletteIndex(section, idx)];
+        default:              return section->data[idx];
+    }
+}
+
+void setSectionBlock(ChunkSection *section, int x, int y, int z, uint8_t value)
+{
+    int idx = SECTION_INDEX(x, y, z);
+
+    if (section->storage == SECTION_UNIFORM)
+    {
+        if (section->palette[0] == value) return;
+        //Promote to a 1 bit palette, every existing block is index 0
+        section->storage = SECTION_PALETTE;
+        section->bits = 1;
+        section->data = calloc(packedBytes(1), 1);
+    }
+
+    if (section->storage == SECTION_PALETTE)
+    {
+        int p = 0;
+        while (p < section->paletteSize && section->palette[p] != value)
+            p++;
+
+        if (p == section->paletteSize)
+        {
+            if (section->paletteSize == SECTION_PALETTE_MAX)
+            {
+                //Too many distinct blocks for a palette, fall back to a byte per block
+                convertToBytes(section);
+                section->data[idx] = value;
+                return;
+            }
+            section->palette[section->paletteSize++] = value;
+            int bits = bitsForPalette(section->paletteSize);
+            if (bits != section->bits)
+                repackPalette(section, bits);
+        }
+        setPaletteIndex(section, idx, p);
+        return;
+    }
+
+    section->data[idx] = value;
+}
+
+void packSection(ChunkSection *section, const uint8_t *raw)
+{
+    freeSection(section);
+
+    int lookup[256];
+    memset(lookup, -1, sizeof(lookup));
+    int distinct = 0;
+    for (int idx = 0; idx < SECTION_VOLUME; idx++)
+    {
+        if (lookup[raw[idx]] < 0)
+        {
+            if (distinct < SECTION_PALETTE_MAX)
+                section->palette[distinct] = raw[idx];
+            lookup[raw[idx]] = distinct++;
+        }
+    }
+
+    if (distinct == 1)
+    {
+        initSection(section, raw[0]);
+        return;
+    }
+
+    if (distinct > SECTION_PALETTE_MAX)
+    {
+        section->storage = SECTION_BYTES;
+        section->bits = 8;
+        section->paletteSize = 0;
+        section->data = malloc(SECTION_VOLUME);
+        memcpy(section->data, raw, SECTION_VOLUME);
+        return;
+    }
+
+    section->storage = SECTION_PALETTE;
+    section->paletteSize = (uint8_t)distinct;
+    section->bits = (uint8_t)bitsForPalette(distinct);
+    section->data = calloc(packedBytes(section->bits), 1);
+    for (int idx = 0; idx < SECTION_VOLUME; idx++)
+        setPaletteIndex(section, idx, lookup[raw[idx]]);
+}
+
+void unpackSection(const ChunkSection *section, uint8_t *raw)
+{
+    switch (section->storage)
+    {
+        case SECTION_UNIFORM:
+            memset(raw, section->palette[0], SECTION_VOLUME);
+            break;
+        case SECTION_PALETTE:
+            for (int idx = 0; idx < SECTION_VOLUME; idx++)
+                raw[idx] = section->palette[getPaletteIndex(section, idx)];
+            break;
+        default:
+            memcpy(raw, section->data, SECTION_VOLUME);
+            break;
+    }
+}
+
+size_t sectionMemoryBytes(const ChunkSection *section)
+{
+    size_t bytes = sizeof(ChunkSection);
+    if (section->storage != SECTION_UNIFORM)
+        bytes += packedBytes(section->bits);
+    return bytes;
+}
+
+size_t encodeSection(const ChunkSection *section, uint8_t *out)
+{
+    size_t n = 0;
+    out[n++] = section->storage;
+    out[n++] = section->bits;
+    out[n++] = section->paletteSize;
+    for (int i = 0; i < section->paletteSize; i++)
+        out[n++] = section->palette[i];
+    if (section->storage == SECTION_UNIFORM) return n;
+
+    size_t bytes = packedBytes(section->bits);
+    for (size_t i = 0; i < bytes; )
+    {
+        size_t run = 1;
+        while (i + run < bytes && run < 256 && section->data[i + run] == section->data[i]) run++;
+        out[n++] = (uint8_t)(run - 1);
+        out[n++] = section->data[i];
+        i += run;
+    }
+    return n;
+}
+
+size_t decodeSection(ChunkSection *section, const uint8_t *in, size_t size)
+{
+    if (size < 3) return 0;
+    int storage = in[0], bits = in[1], paletteSize = in[2];
+    if (paletteSize > SECTION_PALETTE_MAX || size < 3 + (size_t)paletteSize) return 0;
+    if (storage == SECTION_UNIFORM && paletteSize != 1) return 0;
+    if (storage == SECTION_PALETTE && bits != bitsForPalette(paletteSize)) return 0;
+    if (storage == SECTION_BYTES && bits != 8) return 0;
+    if (storage > SECTION_BYTES) return 0;
+
+    freeSection(section);
+    memset(section, 0, sizeof(*section));
+    section->storage = (uint8_t)storage;
+    section->bits = (uint8_t)bits;
+    section->paletteSize = (uint8_t)paletteSize;
+    memcpy(section->palette, in + 3, paletteSize);
+    size_t n = 3 + paletteSize;
+    if (storage == SECTION_UNIFORM) return n;
+
+    size_t bytes = packedBytes(bits);
+    section->data = malloc(bytes);
+    for (size_t i = 0; i < bytes; )
+    {
+        size_t run = (n + 1 < size) ? (size_t)in[n] + 1 : 0;
+        if (run == 0 || i + run > bytes)
+        {
+            freeSection(section);
+            initSection(section, 0);
+            return 0;
+        }
+        memset(section->data + i, in[n + 1], run);
+        i += run;
+        n += 2;
+    }
+    return n;
+}
@@ -0,0 +1,47 @@
+#ifndef SECTION_H
+#define SECTION_H
+
+#include "config.h"
+#include <stdint.h>
+#include <stddef.h>
+
+#define CHUNK_SECTIONS (CHUNK_HEIGHT / SECTION_HEIGHT)
+#define SECTION_VOLUME (CHUNK_WIDTH * SECTION_HEIGHT * CHUNK_WIDTH)
+#define SECTION_PALETTE_MAX 16
+//Index of a block inside a section's raw/packed array (x fastest so rows along x are contiguous)
+#define SECTION_INDEX(x, y, z) ((((y) * CHUNK_WIDTH) + (z)) * CHUNK_WIDTH + (x))
+
+typedef enum SectionStorage {
+    SECTION_UNIFORM,    //Whole section is palette[0], no array allocated
+    SECTION_PALETTE,    //bits-per-block indices into palette (1, 2 or 4 bits)
+    SECTION_BYTES       //Raw block id per block
+} SectionStorage;
+
+//A 16x16x16 slice of a chunk. Terrain is mostly all air or all solid so most sections never allocate.
+typedef struct ChunkSection {
+    uint8_t storage;
+    uint8_t bits;
+    uint8_t paletteSize;
+    uint8_t palette[SECTION_PALETTE_MAX];
+    uint8_t *data;
+} ChunkSection;
+
+void initSection(ChunkSection *section, uint8_t value);
+void freeSection(ChunkSection *section);
+uint8_t getSectionBlock(const ChunkSection *section, int x, int y, int z);
+void setSectionBlock(ChunkSection *section, int x, int y, int z, uint8_t value);
+
+//Bulk conversion between raw SECTION_INDEX ordered bytes and the smallest storage that fits
+void packSection(ChunkSection *section, const uint8_t *raw);
+void unpackSection(const ChunkSection *section, uint8_t *raw);
+
+size_t sectionMemoryBytes(const ChunkSection *section);
+
+//Stored form for region files: storage, bits, palette, then the packed array as (length - 1, byte) runs.
+//Decoding writes the runs straight into the packed array, no repacking
+#define SECTION_ENCODED_MAX (3 + SECTION_PALETTE_MAX + 2 * SECTION_VOLUME)
+size_t encodeSection(const ChunkSection *section, uint8_t *out);
+//Bytes read from in, 0 if they do not hold a valid section
+size_t decodeSection(ChunkSection *section, const uint8_t *in, size_t size);
+
+#endif
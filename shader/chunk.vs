@@ -0,0 +1,61 @@
+#version 330
+
+#ifndef FOG_MODE
+#define FOG_MODE 2 // FOG_QUALITY from config.h, injected at load: 0 off, 1 per vertex, 2 per fragment
+#endif
+
+// Packed chunk vertex (CHUNK_PACKED_VERTICES): block x, y, z inside the chunk and the face index, one unsigned byte each
+in vec4 vertexPosition;
+
+// Input uniform values
+uniform mat4 mvp;
+uniform mat4 matModel;
+
+// Output vertex attributes (to fragment shader), same as fog.vs so fog.fs works unchanged
+out vec3 fragPosition;
+out vec2 fragTexCoord;
+out vec4 fragColor;
+out vec3 fragNormal;
+out vec3 fragWorldPosition;
+#if FOG_MODE == 1
+uniform vec3 viewPos;
+uniform float fogDensity;
+out float fragFog;          // Fog amount, interpolated across the quad instead of evaluated per fragment
+#endif
+
+// Face order from mesh.c: +Z, -Z, +X, -X, +Y, -Y
+const vec3 faceNormals[6] = vec3[6](
+    vec3(0.0, 0.0, 1.0), vec3(0.0, 0.0, -1.0),
+    vec3(1.0, 0.0, 0.0), vec3(-1.0, 0.0, 0.0),
+    vec3(0.0, 1.0, 0.0), vec3(0.0, -1.0, 0.0)
+);
+
+// Same light generateChunkMesh bakes into vertex colors for the float path
+const vec3 lightDir = vec3(-0.6509, -0.6509, -0.3906); // normalize(-1, -1, -0.6)
+const float ambient = 0.25;
+
+void main()
+{
+    vec3 position = vertexPosition.xyz;
+    int face = int(vertexPosition.w + 0.5);
+    vec3 normal = faceNormals[face];
+
+    // Textures repeat every block, so the in-plane block coordinates work as UVs
+    if (face < 2) fragTexCoord = position.xy;
+    else if (face < 4) fragTexCoord = position.zy;
+    else fragTexCoord = position.xz;
+
+    float intensity = ambient + (1.0 - ambient) * max(0.0, dot(normal, lightDir));
+    fragColor = vec4(vec3(min(1.0, intensity)), 1.0);
+
+    fragPosition = position;
+    fragNormal = normal;
+    fragWorldPosition = vec3(matModel * vec4(position, 1.0));
+
+#if FOG_MODE == 1
+    float dist = length(viewPos - fragWorldPosition);
+    fragFog = clamp(1.0 - exp(-pow(fogDensity * dist, 2.0)), 0.0, 1.0);
+#endif
+
+    gl_Position = mvp * vec4(position, 1.0);
+}
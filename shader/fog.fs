@@ -1,11 +1,18 @@
 #version 330
 
+#ifndef FOG_MODE
+#define FOG_MODE 2 // FOG_QUALITY from config.h, injected at load: 0 off, 1 per vertex, 2 per fragment
+#endif
+
 // Input from vertex shader
 in vec3 fragPosition;
 in vec2 fragTexCoord;
 in vec4 fragColor;
 in vec3 fragNormal;
 in vec3 fragWorldPosition;  // NEW: comes from vertex shader now
+#if FOG_MODE == 1
+in float fragFog;           // Already worked out per vertex
+#endif
 
 // Output
 out vec4 finalColor;
@@ -15,6 +22,7 @@ uniform sampler2D texture0;
 uniform vec4 colDiffuse;
 uniform vec3 viewPos;
 uniform float fogDensity;
+uniform vec3 fogColor;      // SKY_COLOR, so distant terrain fades into the sky
 
 void main()
 {
@@ -22,13 +30,16 @@ void main()
     vec4 texelColor = texture(texture0, fragTexCoord);
     vec3 color = texelColor.rgb * fragColor.rgb * colDiffuse.rgb;
     
+#if FOG_MODE == 2
     // Calculate fog using pre-calculated world position (NO matrix multiplication!)
     float dist = length(viewPos - fragWorldPosition);
     float fogFactor = 1.0 - exp(-pow(fogDensity * dist, 2.0));
     fogFactor = clamp(fogFactor, 0.0, 1.0);
-    
-    // Fog color (should match your SKY_COLOR)
-    vec3 fogColor = vec3(0.39, 0.39, 0.39); // ~100/255 = gray
+#elif FOG_MODE == 1
+    float fogFactor = fragFog;
+#else
+    float fogFactor = 0.0;
+#endif
     
     // Mix color with fog
     vec3 finalRGB = mix(color, fogColor, fogFactor);
@@ -1,5 +1,9 @@
 #version 330
 
+#ifndef FOG_MODE
+#define FOG_MODE 2 // FOG_QUALITY from config.h, injected at load: 0 off, 1 per vertex, 2 per fragment
+#endif
+
 // Input vertex attributes
 in vec3 vertexPosition;
 in vec2 vertexTexCoord;
@@ -17,6 +21,11 @@ out vec2 fragTexCoord;
 out vec4 fragColor;
 out vec3 fragNormal;
 out vec3 fragWorldPosition;  // NEW: world position calculated here
+#if FOG_MODE == 1
+uniform vec3 viewPos;
+uniform float fogDensity;
+out float fragFog;          // Fog amount, interpolated across the quad instead of evaluated per fragment
+#endif
 
 void main()
 {
@@ -28,6 +37,11 @@ void main()
     
     // Calculate world position HERE (once per vertex, not per pixel!)
     fragWorldPosition = vec3(matModel * vec4(vertexPosition, 1.0));
+
+#if FOG_MODE == 1
+    float dist = length(viewPos - fragWorldPosition);
+    fragFog = clamp(1.0 - exp(-pow(fogDensity * dist, 2.0)), 0.0, 1.0);
+#endif
     
     // Calculate final vertex position
     gl_Position = mvp * vec4(vertexPosition, 1.0);
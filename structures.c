@@ -0,0 +1,131 @@
+#include "structures.h"
+#include "terrain.h"
+
+#define TREE_SALT 0x7A3B9C1Du //Keeps tree spots apart from the noise lattice
+
+//Pending writes for one chunk, sections are unpacked the first time a feature touches them
+typedef struct FeatureTarget {
+    Chunk *chunk;
+    int originX, originY, originZ; //World block the chunk starts at
+    uint8_t raw[CHUNK_SECTIONS][SECTION_VOLUME];
+    bool unpacked[CHUNK_SECTIONS];
+    int changed;
+} FeatureTarget;
+
+//Higher wins, so the outcome is the same whatever order overlapping features are applied in
+static const uint8_t featurePriority[] = {
+    [AIR] = 0,
+    [LEAVES] = 1,
+    [WOOD] = 2,
+    [SOLID] = 3
+};
+
+static uint32_t siteHash(uint32_t seed, int cx, int cz, int site)
+{
+    uint32_t h = (seed ^ TREE_SALT) + (uint32_t)site * 0x9E3779B9u;
+    h ^= (uint32_t)cx * 0x27D4EB2Du;
+    h ^= (uint32_t)cz * 0x165667B1u;
+    h ^= h >> 15;
+    h *= 0x2C1B3C6Du;
+    h ^= h >> 12;
+    h *= 0x297A2D39u;
+    h ^= h >> 15;
+    return h;
+}
+
+static void writeFeatureBlock(FeatureTarget *target, int wx, int wy, int wz, uint8_t block)
+{
+    int x = wx - target->originX;
+    int y = wy - target->originY;
+    int z = wz - target->originZ;
+    if (x < 0 || x >= CHUNK_WIDTH || y < 0 || y >= CHUNK_HEIGHT || z < 0 || z >= CHUNK_WIDTH) return;
+
+    int s = y / SECTION_HEIGHT;
+    if (!target->unpacked[s])
+    {
+        unpackSection(&target->chunk->sections[s], target->raw[s]);
+        target->unpacked[s] = true;
+    }
+    uint8_t *existing = &target->raw[s][SECTION_INDEX(x, y % SECTION_HEIGHT, z)];
+    if (featurePriority[block] > featurePriority[*existing])
+    {
+        *existing = block;
+        target->changed++;
+    }
+}
+
+//Trunk of 4 to 6 wood with a rounded leaf crown, FEATURE_REACH wide
+static void placeTree(FeatureTarget *target, int wx, int baseY, int wz, int trunk)
+{
+    for (int y = 0; y < trunk; y++)
+        writeFeatureBlock(target, wx, baseY + y, wz, WOOD);
+
+    for (int y = trunk - 2; y <= trunk + 1; y++)
+    {
+        int radius = (y < trunk) ? 2 : 1;
+        for (int dx = -radius; dx <= radius; dx++)
+        {
+            for (int dz = -radius; dz <= radius; dz++)
+            {
+                //Corners off, the top layer becomes a plus
+                bool corner = (dx == radius || dx == -radius) && (dz == radius || dz == -radius);
+                if (corner && (radius == 2 || y == trunk + 1)) continue;
+                writeFeatureBlock(target, wx + dx, baseY + y, wz + dz, LEAVES);
+            }
+        }
+    }
+}
+
+static void placeColumnTrees(FeatureTarget *target, uint32_t seed, int cx, int cz)
+{
+    ColumnHeights column;
+    bool haveHeights = false;
+    for (int site = 0; site < TERRAIN_TREE_SITES; site++)
+    {
+        uint32_t h = siteHash(seed, cx, cz, site);
+        if ((h % 100) >= TERRAIN_TREE_CHANCE) continue;
+        int x = (h >> 8) & (CHUNK_WIDTH - 1);
+        int z = (h >> 12) & (CHUNK_WIDTH - 1);
+        int trunk = 4 + (int)((h >> 16) % 3);
+
+        //Cheap reject before the heights are needed: the tree has to reach into the chunk sideways
+        int wx = cx*CHUNK_WIDTH + x;
+        int wz = cz*CHUNK_WIDTH + z;
+        if (wx + FEATURE_REACH < target->originX || wx - FEATURE_REACH >= target->originX + CHUNK_WIDTH) continue;
+        if (wz + FEATURE_REACH < target->originZ || wz - FEATURE_REACH >= target->originZ + CHUNK_WIDTH) continue;
+
+        if (!haveHeights)
+        {
+            getColumnHeights(cx, cz, &column);
+            haveHeights = true;
+        }
+        int baseY = column.heights[x][z] + 1;
+        int topY = baseY + trunk + 1;
+        if (topY >= WORLD_HEIGHT) continue;
+        if (topY < target->originY || baseY >= target->originY + CHUNK_HEIGHT) continue;
+        placeTree(target, wx, baseY, wz, trunk);
+    }
+}
+
+int placeChunkFeatures(Chunk *chunk, int cx, int cy, int cz)
+{
+    FeatureTarget target;
+    target.chunk = chunk;
+    target.originX = cx * CHUNK_WIDTH;
+    target.originY = cy * CHUNK_HEIGHT;
+    target.originZ = cz * CHUNK_WIDTH;
+    target.changed = 0;
+    for (int s = 0; s < CHUNK_SECTIONS; s++)
+        target.unpacked[s] = false;
+
+    //FEATURE_REACH < CHUNK_WIDTH, so only the eight columns around can reach in
+    uint32_t seed = getTerrainSeed();
+    for (int dx = -1; dx <= 1; dx++)
+        for (int dz = -1; dz <= 1; dz++)
+            placeColumnTrees(&target, seed, cx + dx, cz + dz);
+
+    for (int s = 0; s < CHUNK_SECTIONS; s++)
+        if (target.unpacked[s] && target.changed > 0)
+            packSection(&chunk->sections[s], target.raw[s]);
+    return target.changed;
+}
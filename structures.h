@@ -0,0 +1,16 @@
+#ifndef STRUCTURES_H
+#define STRUCTURES_H
+
+#include "chunk.h"
+
+#define FEATURE_REACH 2 //Blocks a feature may stick out of the column it grows from, less than CHUNK_WIDTH
+
+//Features (trees so far) grow from spots picked by hashing the terrain seed with the chunk column, so they are
+//part of the world like the heightmap. One that crosses a column border is not pushed into its neighbours, which may
+//not exist yet or may be generating on another thread: each chunk gathers the blocks aimed at it from the features
+//of its own and the surrounding columns while it generates, and applies them before anyone else can see it.
+//Overlaps resolve by priority (terrain > wood > leaves > air) so no ordering between features matters either.
+//Returns how many blocks changed
+int placeChunkFeatures(Chunk *chunk, int cx, int cy, int cz);
+
+#endif
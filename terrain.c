@@ -0,0 +1,282 @@
+#include "terrain.h"
+#include <math.h>
+#include <pthread.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define OCTAVE_SEED_STEP 0x9E3779B9u //Each octave gets its own lattice
+
+typedef struct HeightCacheSlot {
+    int cx, cz;
+    bool valid;
+    ColumnHeights heights;
+} HeightCacheSlot;
+
+static pthread_mutex_t cacheLock = PTHREAD_MUTEX_INITIALIZER;
+static HeightCacheSlot heightCache[TERRAIN_CACHE_COLUMNS];
+static const TerrainGenerator *generator = &perlinTerrainSimd;
+static uint32_t terrainSeed = TERRAIN_SEED;
+
+//Clamps into the world and keeps lowest / highest up to date
+static void storeHeight(ColumnHeights *out, int x, int z, int height)
+{
+    if (height < 0) height = 0;
+    if (height >= WORLD_HEIGHT) height = WORLD_HEIGHT - 1;
+    out->heights[x][z] = (int16_t)height;
+    if (height < out->lowest) out->lowest = height;
+    if (height > out->highest) out->highest = height;
+}
+
+static void sineHeights(uint32_t seed, int cx, int cz, ColumnHeights *out)
+{
+    (void)seed;
+    float freq = 0.12f;
+    float amp  = (CHUNK_HEIGHT * 0.5f);
+    int baseH  = WORLD_HEIGHT / 3;
+
+    out->lowest = WORLD_HEIGHT;
+    out->highest = 0;
+    for (int x = 0; x < CHUNK_WIDTH; x++)
+    {
+        for (int z = 0; z < CHUNK_WIDTH; z++)
+        {
+            int worldX = cx*CHUNK_WIDTH + x;
+            int worldZ = cz*CHUNK_WIDTH + z;
+            storeHeight(out, x, z, (int)(((sinf(worldX * freq) + sinf(worldZ * freq * 0.5f)) * 0.5f) * amp) + baseH);
+        }
+    }
+}
+
+//Both Perlin paths below do the same float operations in the same order so they give identical heights
+
+static uint32_t latticeHash(uint32_t seed, int x, int z)
+{
+    uint32_t h = seed ^ ((uint32_t)x * 0x27D4EB2Du) ^ ((uint32_t)z * 0x165667B1u);
+    h ^= h >> 15;
+    h *= 0x2C1B3C6Du;
+    h ^= h >> 12;
+    return h;
+}
+
+static float gradient(uint32_t h, float dx, float dz)
+{
+    //Eight directions, (+-1, +-2) and (+-2, +-1)
+    float u = (h & 4) ? dz : dx;
+    float v = (h & 4) ? dx : dz;
+    return ((h & 1) ? -u : u) + ((h & 2) ? -(v + v) : (v + v));
+}
+
+static float fade(float t)
+{
+    return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+}
+
+static float perlin(uint32_t seed, float x, float z)
+{
+    float x0 = floorf(x);
+    float z0 = floorf(z);
+    int ix = (int)x0;
+    int iz = (int)z0;
+    float fx = x - x0;
+    float fz = z - z0;
+
+    float n00 = gradient(latticeHash(seed, ix, iz), fx, fz);
+    float n10 = gradient(latticeHash(seed, ix + 1, iz), fx - 1.0f, fz);
+    float n01 = gradient(latticeHash(seed, ix, iz + 1), fx, fz - 1.0f);
+    float n11 = gradient(latticeHash(seed, ix + 1, iz + 1), fx - 1.0f, fz - 1.0f);
+
+    float u = fade(fx);
+    float w = fade(fz);
+    float nx0 = n00 + u * (n10 - n00);
+    float nx1 = n01 + u * (n11 - n01);
+    return nx0 + w * (nx1 - nx0);
+}
+
+static int fractalHeight(uint32_t seed, int worldX, int worldZ)
+{
+    float sum = 0.0f, total = 0.0f;
+    float amplitude = 1.0f, frequency = TERRAIN_FREQUENCY;
+    for (int o = 0; o < TERRAIN_OCTAVES; o++)
+    {
+        sum += amplitude * perlin(seed + o * OCTAVE_SEED_STEP, (float)worldX * frequency, (float)worldZ * frequency);
+        total += amplitude;
+        amplitude *= TERRAIN_GAIN;
+        frequency *= 2.0f;
+    }
+    return (int)(sum / total * TERRAIN_AMPLITUDE) + WORLD_HEIGHT / 3;
+}
+
+static void perlinHeights(uint32_t seed, int cx, int cz, ColumnHeights *out)
+{
+    out->lowest = WORLD_HEIGHT;
+    out->highest = 0;
+    for (int x = 0; x < CHUNK_WIDTH; x++)
+        for (int z = 0; z < CHUNK_WIDTH; z++)
+            storeHeight(out, x, z, fractalHeight(seed, cx*CHUNK_WIDTH + x, cz*CHUNK_WIDTH + z));
+}
+
+#ifdef __SSE2__
+//SSE2 has no 32 bit multiply low, build it from the two 32 x 32 -> 64 multiplies
+static __m128i mullo32(__m128i a, __m128i b)
+{
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+static __m128i latticeHash4(__m128i seed, __m128i x, __m128i z)
+{
+    __m128i h = _mm_xor_si128(seed, _mm_xor_si128(mullo32(x, _mm_set1_epi32(0x27D4EB2D)),
+                                                   mullo32(z, _mm_set1_epi32(0x165667B1))));
+    h = _mm_xor_si128(h, _mm_srli_epi32(h, 15));
+    h = mullo32(h, _mm_set1_epi32(0x2C1B3C6D));
+    return _mm_xor_si128(h, _mm_srli_epi32(h, 12));
+}
+
+static __m128 gradient4(__m128i h, __m128 dx, __m128 dz)
+{
+    __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(h, _mm_set1_epi32(4)), _mm_set1_epi32(4)));
+    __m128 u = _mm_or_ps(_mm_and_ps(swap, dz), _mm_andnot_ps(swap, dx));
+    __m128 v = _mm_or_ps(_mm_and_ps(swap, dx), _mm_andnot_ps(swap, dz));
+    //Bits 0 and 1 become the sign bits of u and v
+    __m128 signU = _mm_castsi128_ps(_mm_slli_epi32(h, 31));
+    __m128 signV = _mm_castsi128_ps(_mm_slli_epi32(_mm_srli_epi32(h, 1), 31));
+    return _mm_add_ps(_mm_xor_ps(u, signU), _mm_xor_ps(_mm_add_ps(v, v), signV));
+}
+
+static __m128 fade4(__m128 t)
+{
+    __m128 inner = _mm_add_ps(_mm_mul_ps(t, _mm_sub_ps(_mm_mul_ps(t, _mm_set1_ps(6.0f)), _mm_set1_ps(15.0f))),
+                              _mm_set1_ps(10.0f));
+    return _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(t, t), t), inner);
+}
+
+//floorf without SSE4.1: truncate, then step down where that rounded up
+static __m128 floor4(__m128 x, __m128i *whole)
+{
+    __m128i i = _mm_cvttps_epi32(x);
+    __m128 f = _mm_cvtepi32_ps(i);
+    __m128 above = _mm_cmpgt_ps(f, x);
+    *whole = _mm_add_epi32(i, _mm_castps_si128(above));
+    return _mm_sub_ps(f, _mm_and_ps(above, _mm_set1_ps(1.0f)));
+}
+
+static __m128 perlin4(__m128i seed, __m128 x, __m128 z)
+{
+    __m128i ix, iz;
+    __m128 x0 = floor4(x, &ix);
+    __m128 z0 = floor4(z, &iz);
+    __m128 fx = _mm_sub_ps(x, x0);
+    __m128 fz = _mm_sub_ps(z, z0);
+    __m128i one = _mm_set1_epi32(1);
+    __m128 fx1 = _mm_sub_ps(fx, _mm_set1_ps(1.0f));
+    __m128 fz1 = _mm_sub_ps(fz, _mm_set1_ps(1.0f));
+
+    __m128 n00 = gradient4(latticeHash4(seed, ix, iz), fx, fz);
+    __m128 n10 = gradient4(latticeHash4(seed, _mm_add_epi32(ix, one), iz), fx1, fz);
+    __m128 n01 = gradient4(latticeHash4(seed, ix, _mm_add_epi32(iz, one)), fx, fz1);
+    __m128 n11 = gradient4(latticeHash4(seed, _mm_add_epi32(ix, one), _mm_add_epi32(iz, one)), fx1, fz1);
+
+    __m128 u = fade4(fx);
+    __m128 w = fade4(fz);
+    __m128 nx0 = _mm_add_ps(n00, _mm_mul_ps(u, _mm_sub_ps(n10, n00)));
+    __m128 nx1 = _mm_add_ps(n01, _mm_mul_ps(u, _mm_sub_ps(n11, n01)));
+    return _mm_add_ps(nx0, _mm_mul_ps(w, _mm_sub_ps(nx1, nx0)));
+}
+
+static void perlinHeightsSimd(uint32_t seed, int cx, int cz, ColumnHeights *out)
+{
+    out->lowest = WORLD_HEIGHT;
+    out->highest = 0;
+    for (int x = 0; x < CHUNK_WIDTH; x++)
+    {
+        __m128 worldX = _mm_set1_ps((float)(cx*CHUNK_WIDTH + x));
+        for (int z = 0; z < CHUNK_WIDTH; z += 4)
+        {
+            int baseZ = cz*CHUNK_WIDTH + z;
+            __m128 worldZ = _mm_cvtepi32_ps(_mm_setr_epi32(baseZ, baseZ + 1, baseZ + 2, baseZ + 3));
+
+            __m128 sum = _mm_setzero_ps();
+            float total = 0.0f;
+            float amplitude = 1.0f, frequency = TERRAIN_FREQUENCY;
+            for (int o = 0; o < TERRAIN_OCTAVES; o++)
+            {
+                __m128 f = _mm_set1_ps(frequency);
+                __m128 n = perlin4(_mm_set1_epi32((int)(seed + o * OCTAVE_SEED_STEP)), _mm_mul_ps(worldX, f), _mm_mul_ps(worldZ, f));
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(amplitude), n));
+                total += amplitude;
+                amplitude *= TERRAIN_GAIN;
+                frequency *= 2.0f;
+            }
+            __m128 scaled = _mm_mul_ps(_mm_div_ps(sum, _mm_set1_ps(total)), _mm_set1_ps(TERRAIN_AMPLITUDE));
+            int heights[4];
+            _mm_storeu_si128((__m128i *)heights, _mm_add_epi32(_mm_cvttps_epi32(scaled), _mm_set1_epi32(WORLD_HEIGHT / 3)));
+            for (int i = 0; i < 4; i++)
+                storeHeight(out, x, z + i, heights[i]);
+        }
+    }
+}
+#else
+#define perlinHeightsSimd perlinHeights
+#endif
+
+const TerrainGenerator sineTerrain = { "sine", sineHeights };
+const TerrainGenerator perlinTerrain = { "perlin scalar", perlinHeights };
+#ifdef __SSE2__
+const TerrainGenerator perlinTerrainSimd = { "perlin sse2", perlinHeightsSimd };
+#else
+const TerrainGenerator perlinTerrainSimd = { "perlin scalar (no sse2)", perlinHeightsSimd };
+#endif
+
+void setTerrainGenerator(const TerrainGenerator *newGenerator, uint32_t seed)
+{
+    pthread_mutex_lock(&cacheLock);
+    generator = newGenerator;
+    terrainSeed = seed;
+    for (int i = 0; i < TERRAIN_CACHE_COLUMNS; i++)
+        heightCache[i].valid = false;
+    pthread_mutex_unlock(&cacheLock);
+}
+
+const TerrainGenerator *getTerrainGenerator(void)
+{
+    return generator;
+}
+
+uint32_t getTerrainSeed(void)
+{
+    return terrainSeed;
+}
+
+static int cacheSlot(int cx, int cz)
+{
+    uint32_t h = (uint32_t)cx * 0x9E3779B1u ^ (uint32_t)cz * 0x85EBCA77u;
+    return (int)((h ^ (h >> 16)) & (TERRAIN_CACHE_COLUMNS - 1));
+}
+
+void getColumnHeights(int cx, int cz, ColumnHeights *out)
+{
+    HeightCacheSlot *slot = &heightCache[cacheSlot(cx, cz)];
+    pthread_mutex_lock(&cacheLock);
+    bool hit = slot->valid && slot->cx == cx && slot->cz == cz;
+    if (hit) *out = slot->heights;
+    const TerrainGenerator *current = generator;
+    uint32_t seed = terrainSeed;
+    pthread_mutex_unlock(&cacheLock);
+    if (hit) return;
+
+    //Computed outside the lock, two workers on the same column just both do the work
+    current->fillHeights(seed, cx, cz, out);
+    pthread_mutex_lock(&cacheLock);
+    if (current == generator && seed == terrainSeed)
+    {
+        slot->cx = cx;
+        slot->cz = cz;
+        slot->heights = *out;
+        slot->valid = true;
+    }
+    pthread_mutex_unlock(&cacheLock);
+}
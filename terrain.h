@@ -0,0 +1,33 @@
+#ifndef TERRAIN_H
+#define TERRAIN_H
+
+#include "config.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#define TERRAIN_CACHE_COLUMNS 1024 //Direct mapped column heightmaps, power of two. Well above a full render square
+
+//Surface height of every block column of one chunk column, in world blocks
+typedef struct ColumnHeights {
+    int16_t heights[CHUNK_WIDTH][CHUNK_WIDTH]; //[x][z]
+    int lowest, highest;
+} ColumnHeights;
+
+//Pluggable height source. fillHeights must only depend on seed, cx and cz so any thread can call it
+typedef struct TerrainGenerator {
+    const char *name;
+    void (*fillHeights)(uint32_t seed, int cx, int cz, ColumnHeights *out);
+} TerrainGenerator;
+
+extern const TerrainGenerator sineTerrain;       //The original two sine waves, ignores the seed
+extern const TerrainGenerator perlinTerrain;     //Fractal Perlin noise, one column at a time
+extern const TerrainGenerator perlinTerrainSimd; //Same heights as perlinTerrain, 4 columns at a time with SSE2 (scalar without)
+
+//Switches the generator and seed for chunks generated from now on and forgets the cached heights
+void setTerrainGenerator(const TerrainGenerator *generator, uint32_t seed);
+const TerrainGenerator *getTerrainGenerator(void);
+uint32_t getTerrainSeed(void);
+//Heights of chunk column (cx, cz). Computed once and shared by every layer of the column. Safe from the generation workers
+void getColumnHeights(int cx, int cz, ColumnHeights *out);
+
+#endif
@@ -0,0 +1,264 @@
+#include "threadpool.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <time.h>
+#endif
+
+typedef struct Job {
+    JobFunc func;
+    void *arg;
+    struct Job *next;
+} Job;
+
+struct ThreadPool {
+    pthread_t *threads;
+    int threadCount;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    Job *head;
+    Job *tail;
+    bool stopping;
+};
+
+static void *workerMain(void *arg)
+{
+    ThreadPool *pool = arg;
+    for (;;)
+    {
+        pthread_mutex_lock(&pool->lock);
+        while (pool->head == NULL && !pool->stopping)
+            pthread_cond_wait(&pool->wake, &pool->lock);
+        if (pool->head == NULL)
+        {
+            pthread_mutex_unlock(&pool->lock);
+            return NULL;
+        }
+        Job *job = pool->head;
+        pool->head = job->next;
+        if (pool->head == NULL) pool->tail = NULL;
+        pthread_mutex_unlock(&pool->lock);
+
+        job->func(job->arg);
+        free(job);
+    }
+}
+
+ThreadPool *createThreadPool(int threadCount)
+{
+    if (threadCount < 1) threadCount = 1;
+
+    ThreadPool *pool = calloc(1, sizeof(ThreadPool));
+    pool->threads = malloc(threadCount * sizeof(pthread_t));
+    pool->threadCount = threadCount;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    for (int t = 0; t < threadCount; t++)
+        pthread_create(&pool->threads[t], NULL, workerMain, pool);
+    return pool;
+}
+
+void destroyThreadPool(ThreadPool *pool)
+{
+    if (pool == NULL) return;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = true;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int t = 0; t < pool->threadCount; t++)
+        pthread_join(pool->threads[t], NULL);
+
+    pthread_cond_destroy(&pool->wake);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->threads);
+    free(pool);
+}
+
+void submitJob(ThreadPool *pool, JobFunc func, void *arg)
+{
+    Job *job = malloc(sizeof(Job));
+    job->func = func;
+    job->arg = arg;
+    job->next = NULL;
+
+    pthread_mutex_lock(&pool->lock);
+    if (pool->tail) pool->tail->next = job;
+    else pool->head = job;
+    pool->tail = job;
+    pthread_cond_signal(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+typedef struct WorkRange {
+    pthread_mutex_t lock;
+    int begin;
+    int end;
+} WorkRange;
+
+typedef struct ParallelFor {
+    RangeFunc func;
+    void *ctx;
+    WorkRange *ranges;
+    int rangeCount;
+    pthread_mutex_t doneLock;
+    pthread_cond_t doneCond;
+    int running;
+} ParallelFor;
+
+typedef struct ParallelSlot {
+    ParallelFor *pf;
+    int slot;
+} ParallelSlot;
+
+static bool popRange(WorkRange *range, int *index)
+{
+    bool found = false;
+    pthread_mutex_lock(&range->lock);
+    if (range->begin < range->end)
+    {
+        *index = range->begin++;
+        found = true;
+    }
+    pthread_mutex_unlock(&range->lock);
+    return found;
+}
+
+//Take the back half of the first non-empty range after our own
+static bool stealRange(ParallelFor *pf, int slot)
+{
+    for (int k = 1; k < pf->rangeCount; k++)
+    {
+        WorkRange *victim = &pf->ranges[(slot + k) % pf->rangeCount];
+        int begin = 0, end = 0;
+
+        pthread_mutex_lock(&victim->lock);
+        int remaining = victim->end - victim->begin;
+        if (remaining > 0)
+        {
+            end = victim->end;
+            begin = end - (remaining + 1) / 2;
+            victim->end = begin;
+        }
+        pthread_mutex_unlock(&victim->lock);
+
+        if (end > begin)
+        {
+            WorkRange *own = &pf->ranges[slot];
+            pthread_mutex_lock(&own->lock);
+            own->begin = begin;
+            own->end = end;
+            pthread_mutex_unlock(&own->lock);
+            return true;
+        }
+    }
+    return false;
+}
+
+static void runParallelSlot(ParallelFor *pf, int slot)
+{
+    int index;
+    do {
+        while (popRange(&pf->ranges[slot], &index))
+            pf->func(pf->ctx, index);
+    } while (stealRange(pf, slot));
+}
+
+static void parallelSlotJob(void *arg)
+{
+    ParallelSlot *slot = arg;
+    ParallelFor *pf = slot->pf;
+    runParallelSlot(pf, slot->slot);
+
+    pthread_mutex_lock(&pf->doneLock);
+    pf->running--;
+    pthread_cond_signal(&pf->doneCond);
+    pthread_mutex_unlock(&pf->doneLock);
+}
+
+void parallelFor(ThreadPool *pool, int count, RangeFunc func, void *ctx)
+{
+    if (count <= 0) return;
+
+    int helpers = (pool != NULL) ? pool->threadCount : 0;
+    if (helpers > count - 1) helpers = count - 1;
+    if (helpers == 0)
+    {
+        for (int i = 0; i < count; i++)
+            func(ctx, i);
+        return;
+    }
+
+    ParallelFor pf = {0};
+    pf.func = func;
+    pf.ctx = ctx;
+    pf.rangeCount = helpers + 1;
+    pf.ranges = malloc(pf.rangeCount * sizeof(WorkRange));
+    pf.running = helpers;
+    pthread_mutex_init(&pf.doneLock, NULL);
+    pthread_cond_init(&pf.doneCond, NULL);
+    for (int r = 0; r < pf.rangeCount; r++)
+    {
+        pthread_mutex_init(&pf.ranges[r].lock, NULL);
+        pf.ranges[r].begin = (int)((long long)count * r / pf.rangeCount);
+        pf.ranges[r].end = (int)((long long)count * (r + 1) / pf.rangeCount);
+    }
+
+    ParallelSlot *slots = malloc(helpers * sizeof(ParallelSlot));
+    for (int h = 0; h < helpers; h++)
+    {
+        slots[h] = (ParallelSlot){ &pf, h + 1 };
+        submitJob(pool, parallelSlotJob, &slots[h]);
+    }
+
+    //The caller works slot 0 instead of sitting idle
+    runParallelSlot(&pf, 0);
+
+    pthread_mutex_lock(&pf.doneLock);
+    while (pf.running > 0)
+        pthread_cond_wait(&pf.doneCond, &pf.doneLock);
+    pthread_mutex_unlock(&pf.doneLock);
+
+    for (int r = 0; r < pf.rangeCount; r++)
+        pthread_mutex_destroy(&pf.ranges[r].lock);
+    pthread_cond_destroy(&pf.doneCond);
+    pthread_mutex_destroy(&pf.doneLock);
+    free(pf.ranges);
+    free(slots);
+}
+
+int getThreadPoolSize(const ThreadPool *pool)
+{
+    return pool->threadCount;
+}
+
+int getCpuCount(void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+#endif
+}
+
+double getWallTime(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER freq, now;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return (double)now.QuadPart / (double)freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+#endif
+}
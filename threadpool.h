@@ -0,0 +1,20 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+typedef void (*JobFunc)(void *arg);
+typedef void (*RangeFunc)(void *ctx, int index);
+
+typedef struct ThreadPool ThreadPool;
+
+ThreadPool *createThreadPool(int threadCount);
+//Finishes every queued job before joining the workers
+void destroyThreadPool(ThreadPool *pool);
+void submitJob(ThreadPool *pool, JobFunc func, void *arg);
+int getThreadPoolSize(const ThreadPool *pool);
+//Runs func for every index in [0, count) on the pool plus the calling thread and returns when all are done.
+//Each thread owns a slice of the range and steals half of another's remainder when it runs dry. pool may be NULL
+void parallelFor(ThreadPool *pool, int count, RangeFunc func, void *ctx);
+int getCpuCount(void);
+double getWallTime(void);
+
+#endif
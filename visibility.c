@@ -0,0 +1,219 @@
+#include "visibility.h"
+#include "chunk.h"
+#include <stdlib.h>
+#include <math.h>
+
+#define CELL_INDEX(x, y, z) (((x) * CHUNK_HEIGHT + (y)) * CHUNK_WIDTH + (z))
+#define CHUNK_CELLS (CHUNK_WIDTH * CHUNK_HEIGHT * CHUNK_WIDTH)
+
+typedef struct VisitNode {
+    Chunk *chunk;
+    uint8_t entry;      //Face the walk came in through
+    uint8_t directions; //Every direction stepped so far, the walk never goes back against one
+} VisitNode;
+
+static unsigned int visibleStamp = 0;
+static VisitNode *queue = NULL;
+static int queueCapacity = 0;
+
+static int pairBit(int a, int b)
+{
+    if (a > b) { int t = a; a = b; b = t; }
+    return a * (11 - a) / 2 + (b - a - 1);
+}
+
+bool facesConnected(uint16_t visibility, int a, int b)
+{
+    return a != b && (visibility >> pairBit(a, b)) & 1;
+}
+
+static void faceStep(int face, int *dx, int *dy, int *dz)
+{
+    *dx = (face == FACE_POS_X) - (face == FACE_NEG_X);
+    *dy = (face == FACE_POS_Y) - (face == FACE_NEG_Y);
+    *dz = (face == FACE_POS_Z) - (face == FACE_NEG_Z);
+}
+
+//Flood fills one air pocket from start, clearing open cells as it goes, and returns the faces it touched.
+//Stops early once all six are reached since nothing more can be learned from the pocket
+static uint8_t floodFaces(uint8_t *open, uint16_t *stack, int start)
+{
+    uint8_t faces = 0;
+    int top = 0;
+    stack[top++] = (uint16_t)start;
+    open[start] = 0;
+
+    while (top > 0 && faces != 0x3F)
+    {
+        int cell = stack[--top];
+        int z = cell % CHUNK_WIDTH;
+        int y = (cell / CHUNK_WIDTH) % CHUNK_HEIGHT;
+        int x = cell / (CHUNK_WIDTH * CHUNK_HEIGHT);
+
+        if (x == 0) faces |= 1 << FACE_NEG_X;
+        if (x == CHUNK_WIDTH - 1) faces |= 1 << FACE_POS_X;
+        if (y == 0) faces |= 1 << FACE_NEG_Y;
+        if (y == CHUNK_HEIGHT - 1) faces |= 1 << FACE_POS_Y;
+        if (z == 0) faces |= 1 << FACE_NEG_Z;
+        if (z == CHUNK_WIDTH - 1) faces |= 1 << FACE_POS_Z;
+
+        for (int face = 0; face < 6; face++)
+        {
+            int dx, dy, dz;
+            faceStep(face, &dx, &dy, &dz);
+            int nx = x + dx, ny = y + dy, nz = z + dz;
+            if (nx < 0 || nx >= CHUNK_WIDTH || ny < 0 || ny >= CHUNK_HEIGHT || nz < 0 || nz >= CHUNK_WIDTH) continue;
+            int next = CELL_INDEX(nx, ny, nz);
+            if (!open[next]) continue;
+            open[next] = 0;
+            stack[top++] = (uint16_t)next;
+        }
+    }
+    return faces;
+}
+
+static uint16_t facePairs(uint8_t faces)
+{
+    uint16_t visibility = 0;
+    for (int a = 0; a < 6; a++)
+        for (int b = a + 1; b < 6; b++)
+            if ((faces >> a & 1) && (faces >> b & 1))
+                visibility |= 1 << pairBit(a, b);
+    return visibility;
+}
+
+uint16_t computeFaceConnectivity(const ChunkSnapshot *snapshot)
+{
+    uint8_t open[CHUNK_CELLS];
+    uint16_t stack[CHUNK_CELLS];
+    for (int x = 0; x < CHUNK_WIDTH; x++)
+        for (int y = 0; y < CHUNK_HEIGHT; y++)
+            for (int z = 0; z < CHUNK_WIDTH; z++)
+                open[CELL_INDEX(x, y, z)] = snapshot->blocks[x + 1][y + 1][z + 1] == AIR;
+
+    //Every pocket links all the faces it reaches. Only cells on the chunk surface can reach a face
+    uint16_t visibility = 0;
+    for (int cell = 0; cell < CHUNK_CELLS && visibility != VISIBILITY_ALL; cell++)
+        if (open[cell])
+            visibility |= facePairs(floodFaces(open, stack, cell));
+    return visibility;
+}
+
+//Faces of the camera's own chunk reachable through air from the camera cell.
+//The flood can cover most of the chunk, so it is only redone when the cell or the chunk's blocks change
+static uint8_t cameraFaces(const Chunk *chunk, int lx, int ly, int lz)
+{
+    static const Chunk *lastChunk = NULL;
+    static int lastX, lastY, lastZ;
+    static unsigned int lastVersion;
+    static uint8_t lastFaces;
+
+    if (!chunk->meshed || getChunkBlock(chunk, lx, ly, lz) != AIR) return 0x3F;
+    if (chunk == lastChunk && lx == lastX && ly == lastY && lz == lastZ && chunk->meshVersion == lastVersion)
+        return lastFaces;
+
+    uint8_t open[CHUNK_CELLS];
+    uint16_t stack[CHUNK_CELLS];
+    uint8_t raw[SECTION_VOLUME];
+    for (int s = 0; s < CHUNK_SECTIONS; s++)
+    {
+        unpackSection(&chunk->sections[s], raw);
+        for (int x = 0; x < CHUNK_WIDTH; x++)
+            for (int y = 0; y < SECTION_HEIGHT; y++)
+                for (int z = 0; z < CHUNK_WIDTH; z++)
+                    open[CELL_INDEX(x, s * SECTION_HEIGHT + y, z)] = raw[SECTION_INDEX(x, y, z)] == AIR;
+    }
+    lastChunk = chunk;
+    lastX = lx; lastY = ly; lastZ = lz;
+    lastVersion = chunk->meshVersion;
+    lastFaces = floodFaces(open, stack, CELL_INDEX(lx, ly, lz));
+    return lastFaces;
+}
+
+static int floorDiv(int a, int b)
+{
+    int d = a / b;
+    if ((a ^ b) < 0 && (a % b)) d -= 1;
+    return d;
+}
+
+static void pushVisit(Chunk *chunk, int entry, int directions, int *count)
+{
+    if (*count == queueCapacity)
+    {
+        queueCapacity = queueCapacity ? queueCapacity * 2 : 1024;
+        queue = realloc(queue, queueCapacity * sizeof(VisitNode));
+    }
+    chunk->visibleStamp = visibleStamp;
+    queue[(*count)++] = (VisitNode){ chunk, (uint8_t)entry, (uint8_t)directions };
+}
+
+unsigned int findVisibleChunks(Vector3 cameraPosition, int radius)
+{
+    visibleStamp++;
+    int bx = (int)floorf(cameraPosition.x);
+    int by = (int)floorf(cameraPosition.y);
+    int bz = (int)floorf(cameraPosition.z);
+    int pcx = floorDiv(bx, CHUNK_WIDTH);
+    int pcy = floorDiv(by, CHUNK_HEIGHT);
+    int pcz = floorDiv(bz, CHUNK_WIDTH);
+
+    //Only resident chunks in the render square take part, so nothing new gets generated here
+    #define IN_RANGE(cx, cz) (abs((cx) - pcx) <= radius && abs((cz) - pcz) <= radius)
+
+    int count = 0;
+    if (pcy >= 0 && pcy < WORLD_HEIGHT_CHUNKS)
+    {
+        Chunk *start = findChunk(pcx, pcy, pcz);
+        if (start == NULL) return visibleStamp;
+        start->visibleStamp = visibleStamp;
+
+        uint8_t faces = cameraFaces(start, bx - pcx * CHUNK_WIDTH, by - pcy * CHUNK_HEIGHT, bz - pcz * CHUNK_WIDTH);
+        for (int face = 0; face < 6; face++)
+        {
+            if (!(faces >> face & 1)) continue;
+            int dx, dy, dz;
+            faceStep(face, &dx, &dy, &dz);
+            if (!IN_RANGE(pcx + dx, pcz + dz)) continue;
+            Chunk *next = findChunk(pcx + dx, pcy + dy, pcz + dz);
+            if (next != NULL)
+                pushVisit(next, face ^ 1, 1 << face, &count);
+        }
+    }
+    else
+    {
+        //Camera above or below the world: every chunk of the nearest layer is seen through its outer face
+        int cy = (pcy < 0) ? 0 : WORLD_HEIGHT_CHUNKS - 1;
+        int entry = (pcy < 0) ? FACE_NEG_Y : FACE_POS_Y;
+        for (int cx = pcx - radius; cx <= pcx + radius; cx++)
+            for (int cz = pcz - radius; cz <= pcz + radius; cz++)
+            {
+                Chunk *chunk = findChunk(cx, cy, cz);
+                if (chunk != NULL)
+                    pushVisit(chunk, entry, 1 << (entry ^ 1), &count);
+            }
+    }
+
+    //Breadth first so each chunk keeps the first (most direct) way in
+    for (int head = 0; head < count; head++)
+    {
+        VisitNode node = queue[head];
+        const Chunk *chunk = node.chunk;
+        uint16_t visibility = chunk->meshed ? chunk->visibility : VISIBILITY_ALL;
+
+        for (int face = 0; face < 6; face++)
+        {
+            if (node.directions & (1 << (face ^ 1))) continue;
+            if (!facesConnected(visibility, node.entry, face)) continue;
+
+            int dx, dy, dz;
+            faceStep(face, &dx, &dy, &dz);
+            if (!IN_RANGE(chunk->cx + dx, chunk->cz + dz)) continue;
+            Chunk *next = findChunk(chunk->cx + dx, chunk->cy + dy, chunk->cz + dz);
+            if (next == NULL || next->visibleStamp == visibleStamp) continue;
+            pushVisit(next, face ^ 1, node.directions | (1 << face), &count);
+        }
+    }
+    #undef IN_RANGE
+    return visibleStamp;
+}
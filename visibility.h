@@ -0,0 +1,19 @@
+#ifndef VISIBILITY_H
+#define VISIBILITY_H
+
+#include "raylib.h"
+#include "mesh.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+//Chunk face connectivity: one bit per unordered pair of BlockFaces (15 pairs) set when air links the two faces
+#define VISIBILITY_ALL 0x7FFF
+
+uint16_t computeFaceConnectivity(const ChunkSnapshot *snapshot);
+bool facesConnected(uint16_t visibility, int a, int b);
+
+//Walks the connectivity graph outwards from the camera's chunk inside the render square, never turning back
+//towards the camera. Chunks that might be seen get visibleStamp set to the returned value
+unsigned int findVisibleChunks(Vector3 cameraPosition, int radius);
+
+#endif